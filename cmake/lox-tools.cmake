@@ -42,9 +42,14 @@ function(lox_generate script directory)
 	find_package(Python3 REQUIRED)
 	set(_script ${root}/tools/codegen/${script}.py)
 	set(_config ${root}/tools/codegen/generation_info.json)
+	set(_options)
+	if(LOX_STATIC_VISITORS)
+		list(APPEND _options --static-visitors)
+	endif()
 	execute_process(
-		COMMAND ${Python3_EXECUTABLE} ${_script} --output ${directory} --config ${_config}
+		COMMAND ${Python3_EXECUTABLE} ${_script} --output ${directory} --config ${_config} ${_options}
 	)
+	unset(_options)
 	unset(_config)
 	unset(_script)
 endfunction()
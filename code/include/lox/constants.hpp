@@ -5,5 +5,11 @@
 namespace lox::constants {
 
 constexpr size_t max_call_stack_depth{ 256 };
+constexpr size_t initial_value_stack_size{ 1024 };
+constexpr size_t source_chunk_size{ 64 * 1024 };
+constexpr size_t parallel_scan_min_chunk{ 1024 * 1024 };
+constexpr size_t parallel_scan_sync_window{ 4 * 1024 }; /// how far the previous chunk may run into the next one
+constexpr size_t parallel_parse_min_tokens{ 256 * 1024 };
+constexpr size_t line_index_batch{ 4 * 1024 }; /// how much of the scanned source is indexed at once, it's still cached
 
 } // namespace lox::constants
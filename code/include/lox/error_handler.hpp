@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <vector>
 #include <variant>
@@ -27,6 +28,7 @@ enum class error_code : uint32_t {
 	pe_missing_const_initialization,
 	pe_lvalue_assignment,
 	pe_too_many_arguments,
+	pe_return_outside_function,
 	parser_error_end = 199,
 
 	evaluation_error_begin,
@@ -40,7 +42,13 @@ enum class error_code : uint32_t {
 	ee_invalid_callable,
 	ee_callable_not_found,
 	ee_invalid_arguments_cound,
+	ee_stack_overflow,        /// The calls went deeper than constants::max_call_stack_depth
 	evaluation_error_end = 299,
+
+	compiler_error_begin,
+	ce_too_many_locals,       /// The function has more locals than a bytecode slot can address
+	ce_too_many_arguments,    /// The call has more arguments than a bytecode operand can count
+	compiler_error_end = 399,
 };
 
 enum class warning_code : uint32_t {
@@ -76,6 +84,12 @@ public:
 
 	explicit error_handler(std::string path, std::string_view source_code = {}) noexcept;
 
+	/**
+	 * @brief Lets the positions be found by the line ends of the source instead of searching it.
+	 * It's the index of the context which the caller keeps, and it has to outlive the reports.
+	 */
+	void set_line_index(std::span<const uint32_t> line_ends) noexcept { m_line_ends = line_ends; }
+
 	[[nodiscard]] auto empty() const noexcept -> bool { return std::empty(m_errors); }
 	void report(std::string_view message, error_record record) noexcept;
 	void clear();
@@ -99,13 +113,16 @@ private:
 	std::pmr::unordered_map<uint64_t, std::pmr::string> m_lines{ m_allocator };
 
 	file_info m_file;
+	std::span<const uint32_t> m_line_ends{};
 	std::vector<std::string> m_error_messages{};
 	std::vector<error_record> m_errors{};
 
 	void make_msg(std::pmr::string &buffer, size_t id, const error_record &record) const;
-	auto take_line(const std::string_view source, const error_record &record) const noexcept -> std::pmr::string;
+	auto take_line(const error_record &record) const noexcept -> std::pmr::string;
 
-	static auto relative_to_line(const std::string_view src, uint32_t pos) -> uint16_t;
+	auto relative_to_line(uint32_t pos) const noexcept -> uint16_t;
+	auto last_line_end(size_t pos) const noexcept -> size_t;
+	auto next_line_end(size_t pos) const noexcept -> size_t;
 	inline static auto code_value(const record_code record) noexcept -> uint32_t;
 	inline static auto code_type_name(const record_code record) noexcept -> std::string_view;
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include "lox/aliases.hpp"
+#include "lox/types/token.hpp"
+#include "lox/types/literal.hpp"
+
+namespace lox::execution::bytecode {
+
+/*
+Every instruction is one opcode byte followed by its operands. Operands are
+written in the host byte order: u8, u16 (slots, arguments count) and u32
+(constants, lexemes, tokens and jump offsets). Jump offsets are relative to
+the byte right after the instruction.
+*/
+enum class opcode : uint8_t {
+	constant,       /// [u32 constant]                        -> value
+	null,           ///                                        -> null
+	pop,            /// value                                  ->
+	pop_locals,     /// [u16 count]  locals...                 ->
+
+	get_local,      /// [u16 slot]                             -> value
+	set_local,      /// [u16 slot]                       value -> value
+	get_global,     /// [u32 lexeme, u32 token]                -> value
+	set_global,     /// [u32 lexeme, u32 token]          value -> value
+	get_dynamic,    /// [u32 lexeme, u32 token]                -> value
+	set_dynamic,    /// [u32 lexeme, u32 token]          value -> value
+
+	declare_global, /// [u32 lexeme, u32 token, u8 constant]  ->
+	define_global,  /// [u32 lexeme, u8 constant]       value ->
+	define_local,   /// [u32 lexeme, u8 constant]        value -> value
+
+	incdec_local,   /// [u16 slot, u32 token, u32 op, u8 constant] -> value
+	incdec_global,  /// [u32 lexeme, u32 token, u32 op]        -> value
+	incdec_dynamic, /// [u32 lexeme, u32 token, u32 op]        -> value
+
+	add,            /// [u32 token]                   lhv, rhv -> value
+	subtract,       /// [u32 token]                   lhv, rhv -> value
+	multiply,       /// [u32 token]                   lhv, rhv -> value
+	divide,         /// [u32 token]                   lhv, rhv -> value
+	equal,          /// [u32 token]                   lhv, rhv -> value
+	not_equal,      /// [u32 token]                   lhv, rhv -> value
+	less,           /// [u32 token]                   lhv, rhv -> value
+	less_equal,     /// [u32 token]                   lhv, rhv -> value
+	greater,        /// [u32 token]                   lhv, rhv -> value
+	greater_equal,  /// [u32 token]                   lhv, rhv -> value
+	binary,         /// [u32 token]                   lhv, rhv -> value
+	unary,          /// [u32 token]                      value -> value
+
+	jump,           /// [u32 offset]                           ->
+	jump_if_false,  /// [u32 offset]                 condition ->
+	loop,           /// [u32 offset]  jumps backward           ->
+	logical_and,    /// [u32 offset]                       lhv -> null | (lhv popped)
+	logical_or,     /// [u32 offset]                       lhv -> null | (lhv popped)
+
+	check_call,     /// [u16 count, u32 token, u32 offset] callee -> callee | null
+	call,           /// [u16 count]                callee, args -> value
+	function,       /// [u32 prototype]                        -> callee
+	ret,            ///                                  value ->
+
+	report,         /// [u32 error_code, u32 message, u32 token] ->
+};
+
+constexpr uint32_t no_token{ (std::numeric_limits<uint32_t>::max)() };
+
+struct function_prototype {
+	token name{};
+	uint32_t arity{};
+	std::vector<uint8_t> code{};
+	std::vector<lexeme_id> parameters{}; /// lexeme_database::npos for the shadowed duplicates
+};
+
+struct module {
+	static constexpr size_t script_id{ 0 };
+
+	std::vector<function_prototype> functions{ function_prototype{} };
+	std::vector<literal> constants{};
+	std::vector<token> tokens{};
+	std::vector<std::string> messages{};
+
+	[[nodiscard]] auto script() const noexcept -> const function_prototype & { return functions[script_id]; }
+};
+
+template<class T>
+[[nodiscard]] inline auto read(const uint8_t *&ip) noexcept -> T {
+	T value;
+	std::memcpy(&value, ip, sizeof(T));
+	ip += sizeof(T);
+	return value;
+}
+
+template<class T>
+inline void write(std::vector<uint8_t> &code, const T value) {
+	const auto offset{ std::size(code) };
+	code.resize(offset + sizeof(T));
+	std::memcpy(std::next(std::data(code), static_cast<std::ptrdiff_t>(offset)), &value, sizeof(T));
+}
+
+} // namespace lox::execution::bytecode
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <cstdint>
+
+#include <tl/expected.hpp>
+
+#include "lox/program.hpp"
+#include "lox/error_handler.hpp"
+#include "lox/lexeme_database.hpp"
+#include "lox/execution/bytecode.hpp"
+#include "lox/execution/status.hpp"
+
+namespace lox::execution {
+
+class LOX_EXPORT compiler final
+	: public expression_visitor_interface<void>
+	, public statement_visitor_interface<void> {
+public:
+	compiler(const program &prog, const lexeme_database &lexemes, error_handler &handler) noexcept;
+	~compiler() override = default;
+
+	/** @return the module, or invalid_program when the program can't be encoded and nothing has to run */
+	[[nodiscard]] auto compile() -> tl::expected<bytecode::module, status>;
+
+#pragma region expression::visitor_interface methods
+
+	void accept(const expression_unary &unary) override;
+	void accept(const expression_incdec &incdec) override;
+	void accept(const expression_assignment &assign) override;
+	void accept(const expression_binary &binary) override;
+	void accept(const expression_call &call) override;
+	void accept(const expression_grouping &group) override;
+	void accept(const expression_literal &value) override;
+	void accept(const expression_logical &logic) override;
+	void accept(const expression_identifier &id) override;
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+	void accept(const statement_scope &scope) override;
+	void accept(const statement_expression &expr) override;
+	void accept(const statement_function &func) override;
+	void accept(const statement_branch &branch) override;
+	void accept(const statement_variable &var) override;
+	void accept(const statement_constant &con) override;
+	void accept(const statement_loop &loop) override;
+	void accept(const statement_ret &ret) override;
+
+#pragma endregion statement::visitor_interface methods
+
+private:
+	struct local {
+		lexeme_id name{};
+		uint32_t depth{};
+		bool constant{};
+	};
+
+	struct function_state {
+		size_t prototype{};
+		uint32_t scope_depth{};
+		std::vector<local> locals{};
+	};
+
+	enum class storage : uint8_t { local, dynamic, global };
+	struct resolution {
+		storage kind{ storage::global };
+		uint16_t slot{};
+		bool constant{};
+	};
+
+	std::reference_wrapper<const program> prog;
+	std::reference_wrapper<const lexeme_database> lexemes;
+	std::reference_wrapper<error_handler> errout;
+
+	bytecode::module m_module{};
+	std::vector<function_state> m_states{};
+	bool m_failed{ false }; /// a compile error was reported, the bytecode is broken
+
+	void compile(statement_id stmt);
+	void compile(expression_id expr);
+
+	void begin_scope();
+	void end_scope();
+
+	auto declared_in_scope(lexeme_id name) const noexcept -> bool;
+	void declare_local(lexeme_id name, bool constant, const token &tok);
+	void define_storage(const token &name, bool constant, expression_id initializer, std::string_view kind);
+
+	/** @param target the coordinates the resolver gave to the name, only its globals are trusted */
+	auto resolve(lexeme_id name, coordinates target) const noexcept -> resolution;
+
+	void emit(bytecode::opcode op);
+	void emit_u8(uint8_t value);
+	void emit_u16(uint16_t value);
+	void emit_u32(uint32_t value);
+
+	auto emit_jump(bytecode::opcode op) -> size_t;
+	void patch_jump(size_t operand);
+	void emit_loop(size_t start);
+
+	void emit_report(error_code err_no, std::string message, const token *tok = nullptr);
+	/// Reports the error right away, unlike emit_report(), and fails the compilation
+	void fail(error_code err_no, std::string_view message, const token &tok);
+
+	auto add_constant(literal value) -> uint32_t;
+	auto add_token(const token &tok) -> uint32_t;
+
+	auto state() noexcept -> function_state &;
+	auto state() const noexcept -> const function_state &;
+	auto code() noexcept -> std::vector<uint8_t> &;
+};
+
+} // namespace lox::execution
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <unordered_map>
+
+#include "lox/program.hpp"
+#include "lox/types/value.hpp"
+#include "lox/execution/environment.hpp"
+
+namespace lox::execution {
+
+/**
+ * @brief Computes the expressions with literal operands before the program is run,
+ * so the engines don't repeat them on every pass of a loop.
+ *
+ * The operators are evaluated by the same operators:: functions the engines use,
+ * and an expression is left as it is when it would report an error, or when
+ * the integer operation would overflow. The branches and the loops with a literal
+ * condition are decided, and the statements of a single literal are removed.
+ *
+ * A constant with a literal initializer is put in place of its uses only when
+ * its name isn't bound anywhere else in the program or in the environment.
+ * Functions see the bindings of their callers, so inside of a function only
+ * the global constants and its own ones are taken.
+ */
+class LOX_EXPORT constant_folder final
+	: public expression_visitor_interface<expression_id>
+	, public statement_visitor_interface<statement_id> {
+public:
+	/** @param globals the environment the program will be run with */
+	constant_folder(program &prog, const environment &globals);
+	~constant_folder() override = default;
+
+	/** Folds the program in place and lays it out again without the dropped nodes */
+	void fold();
+
+#pragma region expression::visitor_interface methods
+
+	auto accept(const expression_unary &unary) -> expression_id override;
+	auto accept(const expression_incdec &incdec) -> expression_id override;
+	auto accept(const expression_assignment &assign) -> expression_id override;
+	auto accept(const expression_binary &binary) -> expression_id override;
+	auto accept(const expression_call &call) -> expression_id override;
+	auto accept(const expression_grouping &group) -> expression_id override;
+	auto accept(const expression_literal &value) -> expression_id override;
+	auto accept(const expression_logical &logic) -> expression_id override;
+	auto accept(const expression_identifier &id) -> expression_id override;
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+	auto accept(const statement_scope &scope) -> statement_id override;
+	auto accept(const statement_expression &expr) -> statement_id override;
+	auto accept(const statement_function &func) -> statement_id override;
+	auto accept(const statement_branch &branch) -> statement_id override;
+	auto accept(const statement_variable &var) -> statement_id override;
+	auto accept(const statement_constant &con) -> statement_id override;
+	auto accept(const statement_loop &loop) -> statement_id override;
+	auto accept(const statement_ret &ret) -> statement_id override;
+
+#pragma endregion statement::visitor_interface methods
+
+private:
+	struct constant {
+		expression_id value{}; /// the literal node, shared by all the uses
+		uint32_t function{};   /// the function which declares it, zero outside of functions
+		bool global{};
+	};
+
+	std::reference_wrapper<program> prog;
+	value_heap m_heap{}; /// owns the operands only until they're turned back into literals
+	std::unordered_map<lexeme_id, uint32_t> m_bindings{}; /// lexeme -> count of the declarations with the name
+	std::unordered_map<lexeme_id, constant> m_constants{};
+	std::vector<std::vector<lexeme_id>> m_scopes{ std::vector<lexeme_id>{} }; /// the constants declared by every open scope
+	uint32_t m_function{};
+	uint32_t m_functions_count{};
+	expression_id m_current_expression{};
+	statement_id m_current_statement{};
+
+	[[nodiscard]] auto fold(expression_id expr) -> expression_id;
+	[[nodiscard]] auto fold(statement_id stmt) -> statement_id;
+
+	[[nodiscard]] auto value_of(expression_id expr) -> std::optional<value>;
+	[[nodiscard]] auto make_literal(value val) -> expression_id;
+
+	void begin_scope();
+	void end_scope();
+
+	void count_bindings();
+};
+
+} // namespace lox::execution
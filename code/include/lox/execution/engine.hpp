@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "lox/program.hpp"
+#include "lox/error_handler.hpp"
+#include "lox/lexeme_database.hpp"
+#include "lox/execution/status.hpp"
+#include "lox/execution/environment.hpp"
+
+namespace lox::execution {
+
+enum class engine : uint8_t {
+	tree_walker, /// evaluates the program nodes directly
+	bytecode,    /// compiles the program and runs it on the virtual_machine
+};
+
+[[nodiscard]] constexpr auto engine_name(const engine type) noexcept -> std::string_view {
+	using namespace std::string_view_literals;
+	switch (type) {
+		case engine::tree_walker: return "tree"sv;
+		case engine::bytecode:    return "vm"sv;
+
+		default: break;
+	}
+	return ""sv;
+}
+
+[[nodiscard]] constexpr auto to_engine(const std::string_view name) noexcept -> std::optional<engine> {
+	for (const auto type : { engine::tree_walker, engine::bytecode }) {
+		if (engine_name(type) == name) return type;
+	}
+	return std::nullopt;
+}
+
+auto run(engine type, environment env, const program &prog, const lexeme_database &lexemes, error_handler &handler) -> status;
+
+} // namespace lox::execution
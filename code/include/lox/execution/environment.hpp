@@ -5,6 +5,7 @@
 #include <memory_resource>
 
 #include "lox/types/function.hpp"
+#include "lox/types/coordinates.hpp"
 
 namespace lox::execution {
 
@@ -34,22 +35,39 @@ public:
 	void push_scope();
 	void pop_scope();
 
-	[[nodiscard]] auto define_variable(lexeme_id id, lox::literal value) -> bool;
-	[[nodiscard]] auto define_constant(lexeme_id id, lox::literal value) -> bool;
+	/** @param where the slot the resolver gave to the definition, it spares the search for a duplicate */
+	[[nodiscard]] auto define_variable(lexeme_id id, lox::value value, coordinates where = {}) -> bool;
+	[[nodiscard]] auto define_constant(lexeme_id id, lox::value value, coordinates where = {}) -> bool;
 
 	[[nodiscard]] auto contains(lexeme_id id, search_range::globally_type) const noexcept -> bool;
 	[[nodiscard]] auto contains(lexeme_id id, search_range::current_scope_type _ = {}) const noexcept -> bool;
+	/** @brief Checks the current scope, unless the resolved slot of the definition is the next one */
+	[[nodiscard]] auto contains(lexeme_id id, coordinates where) const noexcept -> bool;
 
-	[[nodiscard]] auto look_up(lexeme_id id) const -> const lox::literal &;
+	[[nodiscard]] auto look_up(lexeme_id id) const -> const lox::value &;
+	/** @return nullptr if there's no such binding */
+	[[nodiscard]] auto look_up(lexeme_id id, coordinates where) const noexcept -> const lox::value *;
 
 	enum class assignment_status : uint8_t { ok, not_found, constant };
-	[[nodiscard]] auto assign(lexeme_id id, lox::literal value) noexcept -> assignment_status;
+	[[nodiscard]] auto assign(lexeme_id id, lox::value value) noexcept -> assignment_status;
+	[[nodiscard]] auto assign(lexeme_id id, coordinates where, lox::value value) noexcept -> assignment_status;
 
 	[[nodiscard]] auto has_function(lexeme_id id) const noexcept -> bool;
 	[[nodiscard]] auto get_function(lexeme_id id) const -> function;
-	[[nodiscard]] auto register_function(lexeme_id id, function fun) -> bool;
+	[[nodiscard]] auto register_function(lexeme_id id, function fun, coordinates where = {}) -> bool;
 
-	[[nodiscard]] auto function_at(size_t id) const noexcept -> std::optional<function>;
+	/** @return nullptr if there's no such function */
+	[[nodiscard]] auto function_at(size_t id) const noexcept -> const function *;
+	[[nodiscard]] auto functions_count() const noexcept -> size_t { return std::size(m_functions); }
+
+	[[nodiscard]] auto heap() noexcept -> value_heap & { return m_heap; }
+
+	template<std::invocable<lexeme_id, lox::value, bool> Visitor>
+	void for_each_binding(Visitor &&visitor) const {
+		for (size_t i{}; i < std::size(m_keys); ++i) {
+			visitor(m_keys[i], m_values[i].value, m_values[i].type == mutability::constant);
+		}
+	}
 
 private:
 	enum class mutability : uint8_t {
@@ -57,7 +75,7 @@ private:
 		variable,
 	};
 	struct value_container {
-		lox::literal value{};
+		lox::value value{};
 		mutability type{ mutability::constant };
 	};
 
@@ -66,10 +84,15 @@ private:
 	std::vector<value_container> m_values;
 	std::vector<function> m_functions;
 	std::vector<size_t> m_scopes;
+	value_heap m_heap;
 
 	auto index_of(lexeme_id id) const noexcept -> int64_t;
-	auto push_value(lexeme_id id, lox::literal value, mutability type) -> bool;
+	auto index_of(lexeme_id id, coordinates where) const noexcept -> int64_t;
+	auto assign_at(int64_t index, lox::value value) noexcept -> assignment_status;
+	auto push_value(lexeme_id id, lox::value value, mutability type, coordinates where) -> bool;
 	auto get_rewind_point() const noexcept -> size_t;
+	auto scope_begin(size_t scope) const noexcept -> size_t;
+	auto scope_end(size_t scope) const noexcept -> size_t;
 };
 
 } // namespace lox::execution
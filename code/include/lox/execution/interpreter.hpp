@@ -1,95 +1,96 @@
 #pragma once
 
+#include <span>
+#include <array>
 #include <optional>
-#include <stdexcept>
 
 #include "lox/program.hpp"
 #include "lox/error_handler.hpp"
 #include "lox/lexeme_database.hpp"
+#include "lox/execution/status.hpp"
+#include "lox/execution/operators.hpp"
 #include "lox/execution/environment.hpp"
 
 namespace lox::execution {
 
-enum class status : uint8_t {
-	ok,
-	invalid_program,
-	runtime_error,
-};
-
-
 class LOX_EXPORT interpreter final
-	: public expression_visitor_interface<literal>
-	, public statement_visitor_interface<void> {
+	: public expression_visitor_interface<value>
+	, public statement_visitor_interface<completion> {
 public:
-	struct execution_error : public std::runtime_error {
-		using std::runtime_error::runtime_error;
-		status reason{ status::runtime_error };
-	};
-
 	interpreter(
 		environment env,
 		const program &prog,
 		const lexeme_database &lexemes,
 		error_handler &handler
-	) noexcept;
+	);
 
 	~interpreter() override = default;
 
 	[[nodiscard]] auto run() -> status;
 	[[nodiscard]] auto runtime_error() const noexcept -> bool { return got_runtime_error; }
 
-	void execute(statement_id stmt);
-	[[nodiscard]] auto evaluate(expression_id expr) -> literal;
+	[[nodiscard]] auto execute(statement_id stmt) -> completion;
+	[[nodiscard]] auto evaluate(expression_id expr) -> value;
 
 
 #pragma region expression::visitor_interface methods
 
-	[[nodiscard]] auto accept(const expression_unary &unary) -> literal override;
-	[[nodiscard]] auto accept(const expression_incdec &incdec) -> literal override;
-	[[nodiscard]] auto accept(const expression_assignment &assign) -> literal override;
-	[[nodiscard]] auto accept(const expression_binary &binary) -> literal override;
-	[[nodiscard]] auto accept(const expression_call &call) -> literal override;
-	[[nodiscard]] auto accept(const expression_grouping &group) -> literal override;
-	[[nodiscard]] auto accept(const expression_literal &value) -> literal override;
-	[[nodiscard]] auto accept(const expression_logical &logic) -> literal override;
-	[[nodiscard]] auto accept(const expression_identifier &id) -> literal override;
+	[[nodiscard]] auto accept(const expression_unary &unary) -> value override;
+	[[nodiscard]] auto accept(const expression_incdec &incdec) -> value override;
+	[[nodiscard]] auto accept(const expression_assignment &assign) -> value override;
+	[[nodiscard]] auto accept(const expression_binary &binary) -> value override;
+	[[nodiscard]] auto accept(const expression_call &call) -> value override;
+	[[nodiscard]] auto accept(const expression_grouping &group) -> value override;
+	[[nodiscard]] auto accept(const expression_literal &lit) -> value override;
+	[[nodiscard]] auto accept(const expression_logical &logic) -> value override;
+	[[nodiscard]] auto accept(const expression_identifier &id) -> value override;
 
 #pragma endregion expression::visitor_interface methods
 
 #pragma region statement::visitor_interface methods
 
-	void accept(const statement_scope &scope) override;
-	void accept(const statement_expression &expr) override;
-	void accept(const statement_function &func) override;
-	void accept(const statement_branch &branch) override;
-	void accept(const statement_variable &var) override;
-	void accept(const statement_constant &con) override;
-	void accept(const statement_loop &loop) override;
+	auto accept(const statement_scope &scope) -> completion override;
+	auto accept(const statement_expression &expr) -> completion override;
+	auto accept(const statement_function &func) -> completion override;
+	auto accept(const statement_branch &branch) -> completion override;
+	auto accept(const statement_variable &var) -> completion override;
+	auto accept(const statement_constant &con) -> completion override;
+	auto accept(const statement_loop &loop) -> completion override;
+	auto accept(const statement_ret &ret) -> completion override;
 
 #pragma endregion statement::visitor_interface methods
 
 
 private:
+	/// The handler of the operand types the node has seen last time
+	template<class Handler, size_t OperandsCount>
+	struct quickened {
+		Handler handler{ nullptr };
+		std::array<literal_type, OperandsCount> operands{};
+	};
+
 	environment m_env{};
+	std::vector<value> m_literals{}; /// values of the program literal expressions
+	std::vector<quickened<operators::binary_handler, 2>> m_binaries{}; /// per binary expression
+	std::vector<quickened<operators::unary_handler, 1>> m_unaries{};   /// per unary expression
+	std::vector<bool> m_distinct_params{}; /// per function declaration: the parameters take the slots in order
+	std::vector<value> m_stack{};    /// arguments of the calls in progress
+	value m_result{}; /// the value of the last executed return statement
+	size_t m_frames_count{ 1 }; /// the script is the first frame, like in the virtual_machine
 	std::reference_wrapper<const program> prog;
 	std::reference_wrapper<const lexeme_database> lexemes;
 	std::reference_wrapper<error_handler> errout;
 	bool got_runtime_error{ false };
-
-	void execute_block(const program::statement_list &statements);
-	void safe_assign(const token &tok, literal value);
-
-	auto error_no_suitable(const token &op, const literal &value) const -> execution_error;
-	auto error_no_suitable(const token &op, const literal &lhv, const literal &rhv) const -> execution_error;
-	auto error(error_code err_no, std::string_view msg, const token &tok) const -> execution_error;
-	auto error(error_code err_no, std::string_view msg) const -> execution_error;
-
-	static auto is_suitable_for(token_type op, literal_type type) -> bool;
-	static auto is_suitable_for(token_type op, literal_type lhv, literal_type rhv) -> bool;
-
-	static auto is_truth(const literal &value) -> std::optional<bool>;
-	static auto negate_number(literal &value) -> bool;
-	static auto inverse_boolean(literal &value) -> bool;
+	bool m_halted{ false }; /// nothing runs or gets reported after the fatal error
+	auto invoke(const function &callee, std::span<const value> args) -> value;
+	auto execute_block(std::span<const statement_id> statements) -> completion;
+	void safe_assign(const token &tok, coordinates target, value val);
+
+	/// Report the error. The failed expression evaluates to the returned null
+	auto error_no_suitable(const token &op, value val) const -> value;
+	auto error_no_suitable(const token &op, value lhv, value rhv) const -> value;
+	auto error(error_code err_no, std::string_view msg, const token &tok) const -> value;
+	auto error(error_code err_no, std::string_view msg) const -> value;
 };
 
 } // namespace lox::execution
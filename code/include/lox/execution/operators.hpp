@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <optional>
+
+#include <tl/expected.hpp>
+
+#include "lox/types/token.hpp"
+#include "lox/types/value.hpp"
+#include "lox/error_handler.hpp"
+
+namespace lox::execution {
+
+using evaluation_result = tl::expected<value, std::string>;
+
+/** Semantics of the lox operators shared by every execution engine */
+namespace operators {
+
+[[nodiscard]] auto binary(value_heap &heap, token_type op, value lhv, value rhv) -> evaluation_result;
+
+[[nodiscard]] auto is_suitable_for(token_type op, literal_type type) noexcept -> bool;
+[[nodiscard]] auto is_suitable_for(token_type op, literal_type lhv, literal_type rhv) noexcept -> bool;
+
+/// Handlers of the operators for known operand types. They skip every type check
+using binary_handler = auto (*)(value_heap &heap, value lhv, value rhv) -> value;
+using unary_handler  = auto (*)(value_heap &heap, value val) -> value;
+
+/** @return the handler for the operand types or nullptr when there's no special one */
+[[nodiscard]] auto specialize(token_type op, literal_type lhv, literal_type rhv) noexcept -> binary_handler;
+[[nodiscard]] auto specialize(token_type op, literal_type type) noexcept -> unary_handler;
+
+[[nodiscard]] auto is_truth(value val) noexcept -> std::optional<bool>;
+[[nodiscard]] auto negate_number(value_heap &heap, value &val) -> bool;
+[[nodiscard]] auto inverse_boolean(value &val) noexcept -> bool;
+
+[[nodiscard]] auto make_no_operator_error(token_type op, value lhv, value rhv) -> std::string;
+[[nodiscard]] auto make_no_suitable_error(token_type op, value val) -> std::string;
+[[nodiscard]] auto make_unknown_operation_error(token_type op) -> std::string;
+
+} // namespace operators
+
+void report(error_handler &handler, error_code err_no, std::string_view msg, const token &tok);
+void report(error_handler &handler, error_code err_no, std::string_view msg);
+
+} // namespace lox::execution
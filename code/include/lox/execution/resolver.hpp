@@ -0,0 +1,114 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "lox/program.hpp"
+#include "lox/execution/environment.hpp"
+
+namespace lox::execution {
+
+/**
+ * @brief Annotates identifiers, assignments and increments with the coordinates
+ * of their bindings, so the interpreter indexes the environment instead of searching it.
+ * Declarations get the slot they define, so the environment doesn't search for duplicates.
+ *
+ * Functions see the bindings of their callers, so a name which isn't declared
+ * by the function itself is resolved as a global only when no caller might have
+ * a local binding with that name when it makes the call. The callers are found
+ * by a first walk over the program: a call by a function name reaches the functions
+ * of that name, any other call might reach every function. Names which might be
+ * shadowed stay unresolved and are looked up by name.
+ */
+class LOX_EXPORT resolver final
+	: public expression_visitor_interface<void>
+	, public statement_visitor_interface<void> {
+public:
+	/** @param globals the environment the program will be run with */
+	resolver(program &prog, const environment &globals);
+	~resolver() override = default;
+
+	void resolve();
+
+#pragma region expression::visitor_interface methods
+
+	void accept(const expression_unary &unary) override;
+	void accept(const expression_incdec &incdec) override;
+	void accept(const expression_assignment &assign) override;
+	void accept(const expression_binary &binary) override;
+	void accept(const expression_call &call) override;
+	void accept(const expression_grouping &group) override;
+	void accept(const expression_literal &value) override;
+	void accept(const expression_logical &logic) override;
+	void accept(const expression_identifier &id) override;
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+	void accept(const statement_scope &scope) override;
+	void accept(const statement_expression &expr) override;
+	void accept(const statement_function &func) override;
+	void accept(const statement_branch &branch) override;
+	void accept(const statement_variable &var) override;
+	void accept(const statement_constant &con) override;
+	void accept(const statement_loop &loop) override;
+	void accept(const statement_ret &ret) override;
+
+#pragma endregion statement::visitor_interface methods
+
+private:
+	/// lexeme -> slot. The slot is the order of definition inside of the scope
+	using scope = std::unordered_map<lexeme_id, uint32_t>;
+	using name_set = std::unordered_set<lexeme_id>;
+
+	static constexpr auto script{ (std::numeric_limits<size_t>::max)() };
+
+	enum class stage : uint8_t {
+		collect,  /// gathers the calls, nothing is written
+		annotate, /// writes the coordinates
+	};
+
+	/// What the calls of a function leave bound for it
+	struct callers_info {
+		name_set names{};           /// bound by the scopes of the calls
+		std::vector<size_t> from{}; /// the functions making the calls, their callers' names pass on
+	};
+
+	std::reference_wrapper<program> prog;
+	std::vector<scope> m_scopes{ scope{} };
+	std::vector<callers_info> m_callers{};   /// per function declaration
+	callers_info m_unknown_callee{};         /// the calls which might reach any function
+	std::vector<name_set> m_shadowed{};      /// per function declaration: the names its callers might bind
+	std::unordered_map<lexeme_id, std::vector<size_t>> m_functions_by_name{};
+	name_set m_value_names{};                /// the names of variables, constants and parameters
+	stage m_stage{ stage::collect };
+	size_t m_function{ script };             /// the declaration of the function being resolved
+	size_t m_function_scope{ 1 };            /// the outermost scope of the function being resolved
+	size_t m_repeated_scope{};               /// the scope a loop runs its body in without a scope of its own
+	expression_id m_current{};
+
+	void resolve(statement_id stmt);
+	void resolve(expression_id expr);
+
+	void begin_scope();
+	void end_scope();
+	/** @return the slot the definition takes, or nothing when the environment has to check it */
+	auto declare(lexeme_id name) -> coordinates;
+
+	[[nodiscard]] auto locate(lexeme_id name) const noexcept -> coordinates;
+
+	void collect_names();
+	void record_call(const expression_call &call);
+	void find_shadowed_names();
+
+	template<statement_type Type>
+	[[nodiscard]] auto record_of(const statement<Type> &node) -> statement<Type> & {
+		auto &records{ prog.get().template get_statements<Type>() };
+		return records[static_cast<size_t>(&node - std::data(records))];
+	}
+};
+
+} // namespace lox::execution
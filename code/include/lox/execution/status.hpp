@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lox::execution {
+
+enum class status : uint8_t {
+	ok,
+	invalid_program,
+	runtime_error,
+};
+
+/// The way a statement has been finished
+enum class completion : uint8_t {
+	normal,
+	returning, /// the result of the function is waiting for the caller
+	halting,   /// the script is stopped by the runtime error
+};
+
+} // namespace lox::execution
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <variant>
+#include <functional>
+
+#include "lox/error_handler.hpp"
+#include "lox/lexeme_database.hpp"
+#include "lox/execution/status.hpp"
+#include "lox/execution/bytecode.hpp"
+#include "lox/execution/environment.hpp"
+
+namespace lox::execution {
+
+/**
+ * @brief Stack based executor of the bytecode::module produced by the compiler.
+ *
+ * Reports the same diagnostics as the interpreter, but keeps locals in the
+ * value stack slots instead of the environment key/value list.
+ */
+class LOX_EXPORT virtual_machine final {
+public:
+	virtual_machine(
+		environment env,
+		const bytecode::module &mod,
+		const lexeme_database &lexemes,
+		error_handler &handler
+	);
+
+	[[nodiscard]] auto run() -> status;
+
+private:
+	struct frame {
+		const bytecode::function_prototype *prototype{};
+		const uint8_t *ip{};
+		size_t base{};          /// the first argument slot. The callee lives right before it
+		size_t bindings_base{};
+	};
+
+	struct binding {
+		lexeme_id name{};
+		size_t slot{};
+		bool constant{};
+	};
+
+	struct global {
+		lox::value value{};
+		bool defined{};
+		bool constant{};
+	};
+
+	/// Either a native function or the prototype index of the module
+	using callable = std::variant<function, size_t>;
+
+	enum class call_check : uint8_t {
+		ok,
+		skipped,  /// the error is reported, the call evaluates to null
+		overflow, /// the error is reported, the script is stopped
+	};
+
+	std::reference_wrapper<const bytecode::module> mod;
+	std::reference_wrapper<const lexeme_database> lexemes;
+	std::reference_wrapper<error_handler> errout;
+
+	value_heap m_heap{};
+	std::vector<value> m_constants{};
+	std::vector<value> m_stack{};
+	std::vector<frame> m_frames{};
+	std::vector<binding> m_bindings{};
+	std::vector<global> m_globals{};
+	std::vector<callable> m_callables{};
+	size_t m_natives_count{};
+
+	auto execute() -> status;
+
+	auto global_at(lexeme_id name) -> global &;
+	auto find_dynamic(lexeme_id name) noexcept -> binding *;
+
+	auto get_global(lexeme_id name, uint32_t tok) -> value;
+	auto get_dynamic(lexeme_id name, uint32_t tok) -> value;
+	void set_global(lexeme_id name, uint32_t tok, value val);
+	void set_dynamic(lexeme_id name, uint32_t tok, value val);
+
+	auto incdec(value &val, bool constant, uint32_t tok, uint32_t op) -> value;
+	auto incdec(lexeme_id name, binding *local, uint32_t tok, uint32_t op) -> value;
+	template<class Operation>
+	void arithmetic(token_type op, uint32_t tok);
+	auto binary(token_type op, value lhv, value rhv, uint32_t tok) -> value;
+	auto unary(value val, uint32_t tok) -> value;
+
+	auto check_call(const value &callee, uint16_t count, uint32_t tok) -> call_check;
+	void call(uint16_t count);
+	auto halt() -> status;
+
+	auto token_at(uint32_t id) const noexcept -> const token &;
+	void error(error_code err_no, std::string_view msg, uint32_t tok) const;
+};
+
+} // namespace lox::execution
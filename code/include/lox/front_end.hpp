@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+#include "lox/types/context.hpp"
+#include "lox/error_handler.hpp"
+#include "lox/source_file.hpp"
+#include "lox/program.hpp"
+
+namespace lox {
+
+/// A script of the project. The errors refer to the file, so it's never moved
+struct LOX_EXPORT source_unit {
+	explicit source_unit(source_file source) noexcept;
+
+	source_file file;
+	error_handler scan_errors;
+	error_handler parse_errors;
+	context ctx{}; /// the identifiers refer to project::lexemes, the own lexemes are left empty
+	program prog{};
+};
+
+struct LOX_EXPORT project {
+	lexeme_database lexemes{}; /// shared by all the units, so the ids are the same in every program
+	std::vector<std::unique_ptr<source_unit>> units{}; /// in the order of the paths
+};
+
+/**
+ * @brief Scans and parses the scripts at once on several threads.
+ * Every file is scanned with its own lexemes first. Then the distinct ones are
+ * looked up in the shared database by all the threads together, and only the
+ * new ones are added under the exclusive lock. The tokens are renumbered before
+ * parsing, so the programs refer to the shared ids.
+ * @param jobs the count of threads, all the hardware ones when it's zero
+ * @return the project or the error of the first file which can't be opened
+ */
+[[nodiscard]] LOX_EXPORT auto parse_files(std::span<const std::string> paths, size_t jobs = 0u)
+	-> tl::expected<project, std::string>;
+
+} // namespace lox
@@ -1,21 +1,70 @@
 #pragma once
 
 #include <limits>
+#include <climits>
+#include <stdexcept>
 #include "lox/utils/compile_time.hpp"
 
 namespace lox {
 
+/**
+ * @brief The handle of a node. The type takes the high bits of the index, so the
+ * handle is as large as the index and the nodes holding the ids get smaller.
+ */
 template<utils::ct::enumeration Type, std::integral IndexType = uint32_t>
 struct ID {
-	static constexpr auto invalid_index{ (std::numeric_limits<IndexType>::max)() };
+	static constexpr size_t type_bits{ 4u };
+	static constexpr size_t index_bits{ sizeof(IndexType) * CHAR_BIT - type_bits };
+	static constexpr auto invalid_index{ static_cast<IndexType>((IndexType{ 1 } << index_bits) - 1u) };
 
 	using enum_type  = Type;
 	using index_type = IndexType;
 
-	IndexType index{ invalid_index };
-	Type      type{};
+	constexpr ID() noexcept = default;
+	constexpr ID(const IndexType node_index, const Type node_type) noexcept
+		: index{ node_index }, m_type{ static_cast<IndexType>(node_type) }
+	{}
 
+	IndexType index : index_bits { invalid_index };
+
+	/** @throws std::length_error when the index doesn't fit into the bits or would read as empty */
+	[[nodiscard]] static constexpr auto make_index(const size_t node_index) -> IndexType {
+		if (node_index >= static_cast<size_t>(invalid_index)) {
+			throw std::length_error{ "Too many nodes of one type for the ids of the program" };
+		}
+		return static_cast<IndexType>(node_index);
+	}
+
+	[[nodiscard]] constexpr auto type() const noexcept -> Type { return static_cast<Type>(m_type); }
 	[[nodiscard]] constexpr auto empty() const noexcept -> bool { return index == invalid_index; }
+	[[nodiscard]] constexpr auto operator==(const ID &other) const noexcept -> bool = default;
+
+private:
+	/// Both fields are declared with the same type, MSVC would start a new unit for an enum one
+	IndexType m_type : type_bits {};
+};
+
+/// The children of a node. They lie one after another in the pool of the program
+template<class T, std::integral IndexType = uint32_t>
+struct pool_range {
+	using value_type = T;
+
+	IndexType offset{};
+	IndexType count{};
+
+	[[nodiscard]] constexpr auto size() const noexcept -> size_t { return static_cast<size_t>(count); }
+	[[nodiscard]] constexpr auto empty() const noexcept -> bool { return count == 0u; }
+	[[nodiscard]] constexpr auto operator==(const pool_range &other) const noexcept -> bool = default;
+};
+
+/// The value of a node, which is kept in the pool of the program
+template<class T, std::integral IndexType = uint32_t>
+struct pool_id {
+	using value_type = T;
+
+	IndexType index{};
+
+	[[nodiscard]] constexpr auto operator==(const pool_id &other) const noexcept -> bool = default;
 };
 
 } // namespace lox
@@ -1,36 +1,57 @@
 #pragma once
 
-#include <map>
 #include <limits>
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <string_view>
-#include <unordered_map>
 
 #include "lox/aliases.hpp"
 #include "lox/export.hpp"
 
 namespace lox {
 
+/**
+ * @brief Interns the lexemes, so every distinct one has a single id.
+ *
+ * The ids are kept in a flat open addressing table. Every slot has a tag of
+ * 7 bits of the hash, and a group of 16 tags is checked at once, so the
+ * lexemes themselves are compared only when the tags match. The bytes are
+ * copied into chunks which are never moved, so the views given by get()
+ * stay valid while the database is alive, moving it included.
+ */
 class LOX_EXPORT lexeme_database {
 public:
 	static constexpr auto npos{ (std::numeric_limits<lexeme_id>::max)() };
 
-	struct section {
-		uint32_t offset{};
-		uint32_t length{};
-	};
-
 	[[nodiscard]] auto add(std::string_view lexeme) noexcept -> lexeme_id;
 	[[nodiscard]] auto find(std::string_view lexeme) const noexcept -> lexeme_id;
 	[[nodiscard]] auto get(lexeme_id id) const noexcept -> std::string_view;
+	/** @return the count of the lexemes. Their ids go from one up to it */
+	[[nodiscard]] auto size() const noexcept -> size_t { return std::size(m_lexemes) - 1u; }
 
 private:
-	std::vector<char> m_buffer{};
-	std::vector<section> m_sections{ section{ 0u, 0u } };
-	std::unordered_map<hash_type, lexeme_id> m_lookup_table{};
+	static constexpr size_t group_size{ 16u };
+	static constexpr size_t chunk_size{ 64u * 1024u };
+
+	struct lookup {
+		size_t slot{};
+		lexeme_id id{ npos };
+	};
+
+	std::vector<std::unique_ptr<char[]>> m_chunks{};
+	size_t m_chunk_used{};     /// bytes taken in the last chunk
+	size_t m_chunk_capacity{}; /// bytes of the last chunk
+
+	std::vector<std::string_view> m_lexemes{ std::string_view{} };
+	std::vector<uint64_t> m_hashes{ 0u }; /// kept to grow the table without hashing the lexemes again
+
+	std::vector<uint8_t> m_tags{};   /// 7 bits of the hash of the slot, the high bit is set when it's empty
+	std::vector<uint32_t> m_slots{}; /// the ids of the lexemes
 
-	auto find(hash_type hash) const noexcept -> lexeme_id;
+	auto locate(std::string_view lexeme, uint64_t hash) const noexcept -> lookup;
+	auto store(std::string_view lexeme) -> std::string_view;
+	void grow();
 };
 
 } // namespace lox
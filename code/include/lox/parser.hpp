@@ -1,6 +1,11 @@
 #pragma once
 
+#include <array>
+#include <span>
+#include <limits>
+#include <vector>
 #include <concepts>
+#include <optional>
 #include <type_traits>
 
 #include "lox/types/context.hpp"
@@ -9,6 +14,8 @@
 
 namespace lox {
 
+class scanner;
+
 class LOX_EXPORT parser {
 public:
 	struct error : public std::runtime_error {
@@ -16,13 +23,42 @@ public:
 	};
 
 	parser(const context &ctx, error_handler &errs) noexcept;
+	/** Pulls the tokens from the scanner while parsing, so they are never stored all together */
+	parser(scanner &stream, error_handler &errs) noexcept;
 
 	[[nodiscard]] auto parse() -> program;
 
+	/**
+	 * @brief Parses the top level declarations on several threads with the same output as parse().
+	 * The declarations are split by the semicolons and the closing braces outside of any brackets.
+	 * Every range is parsed into its own program, and they're appended one after another.
+	 * When a range has errors, the whole script is parsed again by parse(), so the errors are
+	 * reported as usual. The streamed tokens are always parsed by parse().
+	 * @param jobs the count of threads, all the hardware ones when it's zero
+	 */
+	[[nodiscard]] auto parse_parallel(size_t jobs = 0u) -> program;
+
 private:
+	/// The parser looks at the current and the previous tokens only
+	static constexpr size_t window_size{ 4 };
+
 	const context &ctx;
 	error_handler &errout;
 	size_t m_current{};
+	size_t m_end{ (std::numeric_limits<size_t>::max)() }; /// the token where the parsed range ends
+	size_t m_function_depth{};
+
+	/// The children of the nodes being parsed. A node takes its ones from the top into the pools
+	std::vector<statement_id> m_statements{};
+	std::vector<expression_id> m_arguments{};
+	std::vector<token> m_parameters{};
+
+	scanner *m_stream{ nullptr };
+	mutable std::array<token, window_size> m_window{}; /// the last pulled tokens
+	mutable size_t m_pulled{};
+
+	auto split_declarations(size_t jobs) const -> std::vector<size_t>;
+	auto parse_range(size_t from, size_t till) const -> std::optional<program>;
 
 	auto declaration(program &out) -> statement_id;
 	auto function_declaration(program &out, std::string_view kind) -> statement_id;
@@ -37,11 +73,21 @@ private:
 	auto loop_stmt(program &out) -> statement_id;
 	auto for_loop_stmt(program &out) -> statement_id;
 	auto scope_stmt(program &out) -> statement_id;
+	/** @return the size of m_statements before the statements of the block */
+	auto block(program &out) -> size_t;
+	auto return_stmt(program &out) -> statement_id;
+
+	template<class T>
+	auto pool_children(program &out, std::vector<T> &children, size_t mark) -> pool_range<T> {
+		const auto range{ out.store(std::span<const T>{ children }.subspan(mark)) };
+		children.resize(mark);
+		return range;
+	}
 
 	template<statement_type Type>
 	auto make_stmt(program &out, auto content_gen) -> statement_id {
 		auto content{ std::invoke(content_gen, this, out) };
-		consume(token_type::semicolon, "Expected ';' after statement", previous());
+		consume_end_of_statement();
 		return out.emplace<Type>(content);
 	}
 
@@ -58,7 +104,7 @@ private:
 		auto expr_{ std::invoke(next, this, out) };
 
 		while (match<Types...>()) {
-			const auto &op{ previous() };
+			const auto op{ previous() };
 			expr_ = out.emplace<expression_type::binary>(
 				op, expr_, std::invoke(next, this, out)
 			);
@@ -72,7 +118,7 @@ private:
 		auto expr_{ std::invoke(next, this, out) };
 
 		if (match<Types...>()) {
-			const auto &op{ previous() };
+			const auto op{ previous() };
 			expr_ = out.emplace<Expr>(op, expr_, std::invoke(next, this, out));
 		}
 
@@ -83,7 +129,7 @@ private:
 	auto match() -> bool {
 		if (at_end()) return false;
 
-		if (const auto type{ peek().type }; ((type == Types) || ...)) {
+		if (const auto type{ type_at(m_current) }; ((type == Types) || ...)) {
 			++m_current;
 			return true;
 		}
@@ -105,16 +151,19 @@ private:
 	auto primary(program &out) -> expression_id;
 
 	void synchronize();
+	void consume_end_of_statement();
 
 	auto consume(token_type type, std::string_view on_error,
 		const token &tok, error_code code = error_code::pe_unexpected_token
-	) -> const token &;
+	) -> token;
 
-	auto advice() -> const token &;
+	auto advice() -> token;
 	auto check(token_type type) const -> bool;
 	auto at_end() const -> bool;
-	auto peek() const -> const token &;
-	auto previous() const -> const token &;
+	auto peek() const -> token;
+	auto previous() const -> token;
+	auto token_at(size_t index) const -> token;
+	auto type_at(size_t index) const -> token_type;
 
 	auto make_error(std::string_view msg, error_code code, const token &tok) const -> error;
 };
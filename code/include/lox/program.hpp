@@ -20,7 +20,7 @@ public:
 	template<statement_type Type, class ...Args>
 	auto emplace(Args ...args) -> statement_id {
 		auto &record{ get_statements<Type>() };
-		const auto index{ static_cast<statement_id::index_type>(std::size(record)) };
+		const auto index{ statement_id::make_index(std::size(record)) };
 		record.emplace_back(std::forward<Args>(args)...);
 		return statement_id{ index, Type };
 	}
@@ -28,7 +28,7 @@ public:
 	template<expression_type Type, class ...Args>
 	auto emplace(Args ...args) -> expression_id {
 		auto &record{ get_expressions<Type>() };
-		const auto index{ static_cast<expression_id::index_type>(std::size(record)) };
+		const auto index{ expression_id::make_index(std::size(record)) };
 		record.emplace_back(std::forward<Args>(args)...);
 		return expression_id{ index, Type };
 	}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <string_view>
+
+#include "lox/types/line_index.hpp"
+#include "lox/lexeme_database.hpp"
+#include "lox/program.hpp"
+
+namespace lox {
+
+/// The parsed script as it's kept in the .loxc file, with all it needs to be run
+struct LOX_EXPORT cached_program {
+	program prog{};
+	lexeme_database lexemes{};
+	line_index lines{}; /// the errors of the run refer to it, so it has to outlive them
+};
+
+/**
+ * @return the .loxc file in $LOX_CACHE_DIR named by the hash of the absolute path of the script
+ * when the variable is set, else the one next to the script when it's asked for, else nothing
+ */
+[[nodiscard]] LOX_EXPORT auto cache_path(std::string_view script_path, bool beside_script = false) -> std::string;
+
+/**
+ * @brief Maps the cache and reads the program back without scanning or parsing.
+ * The file is refused when its format, the layout of the nodes, or the size and the
+ * hash of the source differ from the current ones, when the checksum of the rest
+ * doesn't match it, when it's cut short, or when a node refers outside of the pools.
+ * @return the program or nothing when the cache is missing or stale
+ */
+[[nodiscard]] LOX_EXPORT auto load_cache(const std::string &path, std::string_view source)
+	-> std::optional<cached_program>;
+
+/**
+ * @brief Writes the program parsed from the source before anything is resolved in it.
+ * The file is written aside and renamed, so the readers never meet a half written one.
+ * @return false when the file can't be written, the script is run as usual then
+ */
+LOX_EXPORT auto store_cache(const std::string &path, std::string_view source,
+	const program &prog, const lexeme_database &lexemes, const line_index &lines
+) -> bool;
+
+} // namespace lox
@@ -1,21 +1,34 @@
 #pragma once
 
+#include <span>
 #include <vector>
 #include <string>
-#include <optional>
+#include <functional>
 #include <string_view>
+#include <unordered_map>
 
 #include "lox/types/context.hpp"
 #include "lox/error_handler.hpp"
+#include "lox/utils/charscan.hpp"
 
 namespace lox {
 
 struct token;
 struct literal;
 
+/**
+ * @brief Splits the script into tokens.
+ *
+ * The scanner either takes the whole script and scans it at once, or reads
+ * the source by chunks and gives the tokens one by one through next(). In the
+ * latter case only the unscanned part of the current chunk is kept in memory.
+ * Large scripts might be scanned by several threads with scan_parallel().
+ */
 class LOX_EXPORT scanner {
 public:
 	using output_type = context;
+	/// Fills the chunk with the next bytes of the source. Returns the count of them, zero at the end
+	using chunk_reader = std::function<size_t(std::span<char> chunk)>;
 
 	struct skip_info {
 		uint32_t skipped{};
@@ -23,28 +36,94 @@ public:
 	};
 
 	explicit scanner(const std::string_view script, error_handler &errs);
+	scanner(chunk_reader reader, error_handler &errs);
 
 	[[nodiscard]] auto scan() -> output_type;
 
+	/**
+	 * @brief Scans the script by chunks on several threads with the same output as scan().
+	 * Every chunk starts on a new line and is scanned as if nothing was open before it.
+	 * When a chunk turns out to begin inside of a string or a comment, it's rescanned
+	 * after the previous one. The sources which are read by chunks are scanned by scan().
+	 * @param jobs the count of threads, all the hardware ones when it's zero
+	 */
+	[[nodiscard]] auto scan_parallel(size_t jobs = 0u) -> output_type;
+
+	/** @return the next token. The end_of_file one is repeated when the source is over */
+	[[nodiscard]] auto next() -> token;
+	/** @return lexemes and literals of the tokens given by next(). The tokens are never kept */
+	[[nodiscard]] auto streamed() noexcept -> output_type & { return m_output; }
+	[[nodiscard]] auto streamed() const noexcept -> const output_type & { return m_output; }
+
+	[[nodiscard]] static auto descriptor_reader(int descriptor) -> chunk_reader;
+
 private:
+	struct deferred_error {
+		std::string message{};
+		error_record record{};
+	};
+
+	/// The state after a token of the chunk. The previous chunk has to stop at one of them
+	struct scan_step {
+		uint32_t position{};
+		uint32_t line{};
+		size_t tokens{};
+		size_t errors{};
+	};
+
+	struct chunk_output {
+		output_type output{};
+		std::vector<deferred_error> errors{};
+		std::vector<scan_step> steps{};
+		uint32_t position{}; /// where the scan of the chunk has stopped
+		uint32_t line{};
+	};
+
 	error_handler &errout;
+	std::string_view m_source;  /// the script as it was given, the lines are indexed by it
 	std::string_view m_script;
 	uint32_t m_line{};
 
+	chunk_reader m_reader{};
+	std::string m_buffer{};   /// the chunks of the source which aren't scanned yet
+	output_type m_output{};   /// the context of next()
+	uint32_t m_base{};        /// the position of m_buffer inside of the source
+	uint32_t m_position{};    /// the position of next() inside of m_buffer
+	uint32_t m_indexed{};     /// the position in m_source till which the line ends are indexed
+	bool m_started{ false };
+	std::vector<deferred_error> *m_deferred{ nullptr }; /// collects the errors of a chunk instead of errout
+
+	std::unordered_multimap<hash_type, uint32_t> m_literal_ids{}; /// the literals by hash_of
+
+	auto start(output_type &output) -> bool;
+	auto ensure(uint32_t position) -> bool; /// reads the source till the position is inside of m_script
+	void discard_scanned();
+
+	template<class Scan>
+	auto scan_through(uint32_t from, Scan scan) -> utils::scan_result;
+
 	auto end_position() const noexcept -> uint32_t;
+	auto absolute(uint32_t position) const noexcept -> uint32_t;
+	auto source_position(uint32_t position) const noexcept -> uint32_t; /// the position in m_source
+
+	void index_lines(line_index &lines, uint32_t till);
+	void index_scanned(line_index &lines, uint32_t position); /// indexes the lines by batches
 
 	auto next_token(uint32_t position, output_type &output) -> uint32_t;
 
+	auto scan_chunk(uint32_t from, uint32_t till, uint32_t line) const -> chunk_output;
+	void merge_chunk(output_type &output, chunk_output &chunk, const scan_step &from, uint32_t line_offset);
+	void report(std::string_view message, error_record record) const;
+
 	auto parse_string_token(uint32_t position, output_type &output) -> uint32_t;
 	auto parse_number_token(uint32_t position, output_type &output) -> uint32_t;
 	auto parse_identifier_token(uint32_t position, output_type &output) -> uint32_t;
-	auto try_parse_null_or_boolean(uint32_t position, output_type &output) -> std::optional<uint32_t>;
 
-	auto skip_till(const char matches, uint32_t from) const noexcept -> uint32_t;
-	auto skip_whitespaces(uint32_t position) noexcept -> uint32_t;
-	auto skip_multiline_comment(uint32_t position) noexcept -> uint32_t;
+	auto skip_till(const char matches, uint32_t from) -> uint32_t;
+	auto skip_whitespaces(uint32_t position) -> uint32_t;
+	auto skip_multiline_comment(uint32_t position) -> uint32_t;
 
-	auto emplace_literal(literal lit, std::vector<literal> &out) -> uint16_t;
+	auto emplace_literal(literal lit, std::vector<literal> &out) -> uint32_t;
 	void make_error_unexpected_symbol(uint32_t pos) const;
 };
 
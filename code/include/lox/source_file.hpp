@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <tl/expected.hpp>
+
+#include "lox/export.hpp"
+
+namespace lox {
+
+/**
+ * @brief The script file mapped read-only into the memory.
+ * The view stays valid while the object is alive, so it's given to the scanner
+ * and to the error_handler without a copy. The files which can't be mapped,
+ * like pipes, and the platforms without mmap fall back to reading the content.
+ */
+class LOX_EXPORT source_file {
+public:
+	[[nodiscard]] static auto open(std::string path) -> tl::expected<source_file, std::string>;
+
+	source_file(source_file &&other) noexcept;
+	auto operator=(source_file &&other) noexcept -> source_file &;
+
+	source_file(const source_file &) = delete;
+	auto operator=(const source_file &) -> source_file & = delete;
+
+	~source_file();
+
+	[[nodiscard]] auto path() const noexcept -> const std::string & { return m_path; }
+	[[nodiscard]] auto view() const noexcept -> std::string_view { return m_view; }
+
+private:
+	explicit source_file(std::string path) noexcept;
+
+	std::string m_path{};
+	std::string_view m_view{};
+	std::string m_content{}; /// the read content when the file isn't mapped
+	bool m_mapped{ false };
+
+	void unmap() noexcept;
+};
+
+} // namespace lox
@@ -1,15 +1,18 @@
 #pragma once
 
 #include "lox/types/token.hpp"
+#include "lox/types/token_buffer.hpp"
 #include "lox/types/literal.hpp"
+#include "lox/types/line_index.hpp"
 #include "lox/lexeme_database.hpp"
 
 namespace lox {
 
 struct context {
 	lexeme_database lexemes{};
-	std::vector<token> tokens{};
+	token_buffer tokens{};
 	std::vector<literal> literals{};
+	line_index lines{}; /// the line ends of the whole script, empty when it's read by chunks
 };
 
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lox {
+
+/**
+ * @brief The place of a binding precomputed by the resolver.
+ *
+ * Local bindings are addressed by the count of scopes between the current
+ * scope and the one which owns the binding (`depth`) and by the order of the
+ * binding inside of that scope (`slot`). Global bindings use `slot` only.
+ * Unresolved coordinates make the environment fall back to the name lookup.
+ */
+struct coordinates {
+	enum class kind : uint8_t {
+		unresolved,
+		local,
+		global,
+	};
+
+	uint32_t depth{};
+	uint32_t slot{};
+	kind storage{ kind::unresolved };
+
+	[[nodiscard]] constexpr auto empty() const noexcept -> bool { return storage == kind::unresolved; }
+	[[nodiscard]] constexpr auto operator==(const coordinates &other) const noexcept -> bool = default;
+};
+
+} // namespace lox
@@ -2,28 +2,40 @@
 
 #include <span>
 #include <array>
+#include <limits>
 #include <optional>
-#include <functional>
 
 #include "lox/export.hpp"
 #include "lox/aliases.hpp"
 #include "lox/types/token.hpp"
-#include "lox/types/literal.hpp"
+#include "lox/types/value.hpp"
 
 namespace lox {
 
 class LOX_EXPORT function {
 public:
-	using signature = literal(void *, std::span<const literal>);
+	using signature = value(value_heap &, std::span<const value>);
 
-	explicit function(std::function<signature> function, std::optional<size_t> arity = {}) noexcept
-		: m_func{ std::move(function) }, m_arity{ arity } {}
+	static constexpr auto npos{ (std::numeric_limits<size_t>::max)() };
 
-	[[nodiscard]] auto call(auto *runner, std::span<const literal> args = {}) -> literal {
-		if (valid() && enough_arguments_count(std::size(args))) {
-			return m_func(runner, args);
+	explicit function(signature *native, std::optional<size_t> arity = {}) noexcept
+		: m_native{ native }, m_arity{ arity } {}
+
+	/**
+	 * @brief The function declared by the script.
+	 * Only the engine which registered it knows how to call the declaration
+	 */
+	[[nodiscard]] static auto declared(size_t declaration, size_t arity) noexcept -> function {
+		function fun{ nullptr, arity };
+		fun.m_declaration = declaration;
+		return fun;
+	}
+
+	[[nodiscard]] auto call(value_heap &heap, std::span<const value> args = {}) const -> value {
+		if (native() && enough_arguments_count(std::size(args))) {
+			return m_native(heap, args);
 		}
-		return null_literal;
+		return value::null();
 	}
 
 	// template<class ...Args>
@@ -35,15 +47,18 @@ public:
 	// }
 
 	[[nodiscard]] auto arity() const noexcept -> std::optional<size_t> { return m_arity; }
-	[[nodiscard]] auto valid() const noexcept -> bool { return m_func != nullptr; }
+	[[nodiscard]] auto declaration() const noexcept -> size_t { return m_declaration; }
+	[[nodiscard]] auto native() const noexcept -> bool { return m_native != nullptr; }
+	[[nodiscard]] auto valid() const noexcept -> bool { return native() || m_declaration != npos; }
 
 	[[nodiscard]] auto enough_arguments_count(const size_t args_count) const noexcept -> bool {
 		return !m_arity.has_value() || m_arity == args_count;
 	}
 
 private:
-	std::function<signature> m_func{};
+	signature *m_native{};
 	std::optional<size_t> m_arity{};
+	size_t m_declaration{ npos };
 };
 
 } // namespace lox
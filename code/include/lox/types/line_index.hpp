@@ -0,0 +1,23 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include "lox/export.hpp"
+
+namespace lox {
+
+/// The positions of the line ends ('\n') of the script in the ascending order
+using line_index = std::vector<uint32_t>;
+
+[[nodiscard]] LOX_EXPORT auto make_line_index(std::string_view script) -> line_index;
+
+/** @return the last line end at or before the position, npos when there's none. Like find_last_of */
+[[nodiscard]] LOX_EXPORT auto last_line_end(std::span<const uint32_t> index, size_t position) noexcept -> size_t;
+
+/** @return the first line end at or after the position, npos when there's none. Like find_first_of */
+[[nodiscard]] LOX_EXPORT auto next_line_end(std::span<const uint32_t> index, size_t position) noexcept -> size_t;
+
+} // namespace lox
@@ -44,6 +44,8 @@ const literal null_literal{};
 [[nodiscard]] auto to_number_literal(const std::string_view str_value) -> literal;
 [[nodiscard]] auto to_literal(const std::string_view str_value) -> literal;
 [[nodiscard]] auto to_string(const literal &lit) -> std::string;
+/** @return the hash of the type and the value, the strings are hashed by their content */
+[[nodiscard]] auto hash_of(const literal &lit) noexcept -> hash_type;
 [[nodiscard]] constexpr auto type_name(const literal_type type) noexcept -> std::string_view {
 	using namespace std::string_view_literals;
 	switch (type) {
@@ -15,9 +15,9 @@ namespace lox::native {
 auto add_native_functions(lexeme_database &db, execution::environment &env) -> size_t;
 
 
-[[nodiscard]] auto fn_print_impl(void *, std::span<const literal>) -> literal;
-[[nodiscard]] auto fn_println_impl(void *, std::span<const literal>) -> literal;
-[[nodiscard]] auto fn_time_now_impl(void *, std::span<const literal>) -> literal;
+[[nodiscard]] auto fn_print_impl(value_heap &, std::span<const value>) -> value;
+[[nodiscard]] auto fn_println_impl(value_heap &, std::span<const value>) -> value;
+[[nodiscard]] auto fn_time_now_impl(value_heap &, std::span<const value>) -> value;
 
 const function fn_print   { fn_print_impl };
 const function fn_println { fn_println_impl };
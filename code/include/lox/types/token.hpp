@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <limits>
+#include <algorithm>
 #include <cstdint>
 #include <string_view>
 
@@ -8,7 +10,7 @@
 
 namespace lox {
 
-enum class token_type : uint32_t {
+enum class token_type : uint8_t {
 	invalid,
 
 	// Single character tokens
@@ -37,13 +39,13 @@ enum class token_type : uint32_t {
 	end_of_file = 0xFFu
 };
 
-constexpr uint16_t invalid_id{ (std::numeric_limits<uint16_t>::max)() };
+constexpr uint32_t invalid_id{ (std::numeric_limits<uint32_t>::max)() };
 
 struct LOX_EXPORT token {
 	uint32_t line{};
 	uint32_t position{};
-	uint16_t literal_id{ invalid_id };
-	uint16_t lexeme_id{ invalid_id };
+	uint32_t literal_id{ invalid_id };
+	uint32_t lexeme_id{ invalid_id };
 	token_type type{ token_type::invalid };
 
 	[[nodiscard]] constexpr auto operator==(const token &other) const noexcept -> bool = default;
@@ -185,7 +187,116 @@ struct LOX_EXPORT token {
 
 #pragma warning(pop)
 
-[[nodiscard]] auto from_keyword(const std::string_view name) noexcept -> token_type;
+/**
+ * @brief The words which aren't identifiers: the keywords, null, true and false.
+ * They're looked up by a minimal perfect hash over the length, the first and
+ * the last characters, which is built from keyword_name at compile time.
+ */
+namespace reserved_words {
+
+struct entry {
+	std::string_view word{};
+	token_type type{ token_type::identifier };
+};
+
+constexpr auto list{ [] {
+	using namespace std::string_view_literals;
+	constexpr auto is_keyword{ [](uint32_t type) { return !std::empty(keyword_name(static_cast<token_type>(type))); } };
+	constexpr auto last_type{ static_cast<uint32_t>(token_type::end_of_file) };
+
+	constexpr auto keywords_count{ [=] {
+		size_t count{};
+		for (uint32_t type{}; type < last_type; ++type) count += is_keyword(type);
+		return count;
+	}() };
+
+	std::array<entry, keywords_count + 2u> words{
+		entry{ "true"sv, token_type::boolean },
+		entry{ "false"sv, token_type::boolean }
+	};
+	for (uint32_t type{}, i{ 2u }; type < last_type; ++type) {
+		if (is_keyword(type)) {
+			words[i++] = entry{ keyword_name(static_cast<token_type>(type)), static_cast<token_type>(type) };
+		}
+	}
+	return words;
+}() };
+
+constexpr auto count{ std::size(list) };
+
+/// The words with the same first character are moved together by its displacement
+[[nodiscard]] constexpr auto slot_of(const std::string_view word, const uint8_t displacement) noexcept -> size_t {
+	return (std::size(word) + static_cast<uint8_t>(word.back()) + displacement) % count;
+}
+
+struct hash_table {
+	std::array<uint8_t, 0x100> displacements{};
+	std::array<entry, count> slots{};
+	size_t min_length{ (std::numeric_limits<size_t>::max)() };
+	size_t max_length{};
+	bool is_perfect{ true };
+};
+
+constexpr auto table{ [] {
+	hash_table result{};
+	std::array<size_t, 0x100> group_sizes{};
+	for (const auto &[word, _] : list) {
+		++group_sizes[static_cast<uint8_t>(word.front())];
+		result.min_length = (std::min)(result.min_length, std::size(word));
+		result.max_length = (std::max)(result.max_length, std::size(word));
+	}
+
+	/// The largest groups go first while there is the most free slots
+	for (auto size{ count }; size > 0u; --size) {
+		for (size_t first{}; first < std::size(group_sizes); ++first) {
+			if (group_sizes[first] != size) continue;
+
+			const auto fits{ [&](const uint8_t displacement) {
+				std::array<bool, count> taken{};
+				for (const auto &[word, _] : list) {
+					if (static_cast<uint8_t>(word.front()) != first) continue;
+
+					const auto slot{ slot_of(word, displacement) };
+					if (taken[slot] || !std::empty(result.slots[slot].word)) return false;
+					taken[slot] = true;
+				}
+				return true;
+			} };
+
+			uint8_t displacement{};
+			while (displacement < count && !fits(displacement)) ++displacement;
+			if (displacement == count) {
+				result.is_perfect = false;
+				continue;
+			}
+
+			result.displacements[first] = displacement;
+			for (const auto &found : list) {
+				if (static_cast<uint8_t>(found.word.front()) == first) {
+					result.slots[slot_of(found.word, displacement)] = found;
+				}
+			}
+		}
+	}
+	return result;
+}() };
+
+static_assert(table.is_perfect, "The reserved words have to be placed without collisions");
+
+} // namespace reserved_words
+
+/** @return the keyword, null or boolean type of the word or the identifier one */
+[[nodiscard]] constexpr auto from_keyword(const std::string_view name) noexcept -> token_type {
+	using reserved_words::table;
+
+	if (std::size(name) < table.min_length || std::size(name) > table.max_length) {
+		return token_type::identifier;
+	}
+
+	const auto displacement{ table.displacements[static_cast<uint8_t>(name.front())] };
+	const auto &[word, type]{ table.slots[reserved_words::slot_of(name, displacement)] };
+	return word == name ? type : token_type::identifier;
+}
 
 [[nodiscard]] auto name_from_script(const token &tok, const std::string_view script) noexcept -> std::string_view;
 
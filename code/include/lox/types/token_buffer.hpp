@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <concepts>
+#include <stdexcept>
+
+#include "lox/export.hpp"
+#include "lox/types/token.hpp"
+
+namespace lox {
+
+/**
+ * @brief The tokens of the script stored as structure of arrays.
+ * The parser mostly checks the types, so they're kept apart by one byte.
+ * A token refers either to a lexeme or to a literal, so it has a single payload id.
+ */
+class LOX_EXPORT token_buffer {
+public:
+	void emplace_back(uint32_t line, uint32_t position, uint32_t literal_id, uint32_t lexeme_id, token_type type) {
+		m_types.push_back(type);
+		m_lines.push_back(line);
+		m_positions.push_back(position);
+		m_payloads.push_back(type == token_type::identifier ? lexeme_id : literal_id);
+	}
+
+	void push_back(const token &tok) {
+		emplace_back(tok.line, tok.position, tok.literal_id, tok.lexeme_id, tok.type);
+	}
+
+	/**
+	 * @brief Appends the tokens of the other buffer starting from the index.
+	 * @param line_offset is added to the lines of the appended tokens
+	 * @param map_payload gives the new payload id by the type and the old one
+	 */
+	template<std::invocable<token_type, uint32_t> MapPayload>
+	void append(const token_buffer &other, const size_t from, const uint32_t line_offset, MapPayload map_payload) {
+		m_types.insert(std::end(m_types), std::next(std::begin(other.m_types), from), std::end(other.m_types));
+		m_positions.insert(std::end(m_positions), std::next(std::begin(other.m_positions), from), std::end(other.m_positions));
+		for (auto i{ from }; i < std::size(other); ++i) {
+			m_lines.push_back(other.m_lines[i] + line_offset);
+		}
+		for (auto i{ from }; i < std::size(other); ++i) {
+			m_payloads.push_back(map_payload(other.m_types[i], other.m_payloads[i]));
+		}
+	}
+
+	[[nodiscard]] auto operator[](const size_t index) const noexcept -> token {
+		const auto type{ m_types[index] };
+		const auto payload{ m_payloads[index] };
+		const auto is_identifier{ type == token_type::identifier };
+
+		return token{
+			.line       = m_lines[index],
+			.position   = m_positions[index],
+			.literal_id = is_identifier ? invalid_id : payload,
+			.lexeme_id  = is_identifier ? payload : invalid_id,
+			.type       = type
+		};
+	}
+
+	[[nodiscard]] auto at(const size_t index) const -> token {
+		check_range(index);
+		return (*this)[index];
+	}
+
+	[[nodiscard]] auto type_at(const size_t index) const -> token_type {
+		check_range(index);
+		return m_types[index];
+	}
+
+	[[nodiscard]] auto front() const noexcept -> token { return (*this)[0u]; }
+	[[nodiscard]] auto back() const noexcept -> token { return (*this)[size() - 1u]; }
+
+	[[nodiscard]] auto size() const noexcept -> size_t { return std::size(m_types); }
+	[[nodiscard]] auto empty() const noexcept -> bool { return std::empty(m_types); }
+
+	void reserve(const size_t count) {
+		m_types.reserve(count);
+		m_lines.reserve(count);
+		m_positions.reserve(count);
+		m_payloads.reserve(count);
+	}
+
+	void clear() noexcept {
+		m_types.clear();
+		m_lines.clear();
+		m_positions.clear();
+		m_payloads.clear();
+	}
+
+private:
+	std::vector<token_type> m_types{};
+	std::vector<uint32_t> m_lines{};
+	std::vector<uint32_t> m_positions{};
+	std::vector<uint32_t> m_payloads{}; /// lexeme id of the identifiers and literal id of the others
+
+	void check_range(const size_t index) const {
+		if (index >= size()) {
+			throw std::out_of_range{ "The token index is out of the buffer" };
+		}
+	}
+};
+
+} // namespace lox
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <bit>
+#include <memory>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "lox/export.hpp"
+#include "lox/types/literal.hpp"
+
+namespace lox {
+
+/**
+ * @brief The runtime value of the execution engines packed into 8 bytes.
+ *
+ * Numbers are stored as they are. Other types live inside of the negative quiet
+ * NaN space: 3 bits of the tag and 48 bits of the payload. Strings and integers
+ * which don't fit 48 bits are objects made by the value_heap and referenced by
+ * pointer. The objects count the values referring to them and are freed by the
+ * last one, so copying such a value is copying a word and bumping the counter.
+ *
+ * Strings up to short_string_capacity bytes are stored inside of the payload,
+ * longer ones are interned by the heap while any value refers to them. So two
+ * interned strings are equal only when their values have the same bits. The results of the concatenation are
+ * slices of the heap append buffers instead, so they have to be compared by content.
+ */
+class LOX_EXPORT value {
+public:
+	static constexpr size_t short_string_capacity{ 5 };
+
+	constexpr value() noexcept = default;
+	constexpr value(const value &other) noexcept : bits{ other.bits } { retain(); }
+	constexpr value(value &&other) noexcept : bits{ std::exchange(other.bits, null_bits) } {}
+	constexpr ~value() { release(); }
+
+	constexpr auto operator=(const value &other) noexcept -> value & {
+		other.retain();
+		release();
+		bits = other.bits;
+		return *this;
+	}
+	constexpr auto operator=(value &&other) noexcept -> value & {
+		if (this != &other) {
+			release();
+			bits = std::exchange(other.bits, null_bits);
+		}
+		return *this;
+	}
+
+	[[nodiscard]] static constexpr auto null() noexcept -> value { return value{}; }
+	[[nodiscard]] static constexpr auto boolean(bool flag) noexcept -> value {
+		return value{ tag::boolean, static_cast<uint64_t>(flag) };
+	}
+	[[nodiscard]] static constexpr auto number(double num) noexcept -> value {
+		return value{ num != num ? canonical_nan : std::bit_cast<uint64_t>(num) };
+	}
+	/** @warning The integer has to fit 48 bits. Use value_heap::integral otherwise */
+	[[nodiscard]] static constexpr auto integral(int64_t num) noexcept -> value {
+		return value{ tag::integral, static_cast<uint64_t>(num) & payload_mask };
+	}
+	[[nodiscard]] static constexpr auto fits_inline(int64_t num) noexcept -> bool {
+		return num >= min_inline_integral && num <= max_inline_integral;
+	}
+	/** @warning The string has to fit short_string_capacity. Use value_heap::string otherwise */
+	[[nodiscard]] static constexpr auto short_string(std::string_view str) noexcept -> value {
+		uint64_t payload{ static_cast<uint64_t>(std::size(str)) };
+		for (size_t i{}; i < std::size(str); ++i) {
+			payload |= static_cast<uint64_t>(static_cast<uint8_t>(str[i])) << char_shift(i);
+		}
+		return value{ tag::short_string, payload };
+	}
+	[[nodiscard]] static constexpr auto fits_inline(std::string_view str) noexcept -> bool {
+		return std::size(str) <= short_string_capacity;
+	}
+
+	[[nodiscard]] constexpr auto type() const noexcept -> literal_type {
+		if (!is_tagged()) return literal_type::number;
+
+		switch (get_tag()) {
+			case tag::boolean:       return literal_type::boolean;
+			case tag::integral:      [[fallthrough]];
+			case tag::wide_integral: return literal_type::integral;
+			case tag::string:        [[fallthrough]];
+			case tag::short_string:  [[fallthrough]];
+			case tag::slice:         return literal_type::string;
+
+			default: break;
+		}
+		return literal_type::null;
+	}
+	[[nodiscard]] constexpr auto is(literal_type type) const noexcept -> bool { return this->type() == type; }
+
+	/// The accessors don't check the type. Make sure it's the right one using is() first
+	[[nodiscard]] constexpr auto as_boolean() const noexcept -> bool { return (bits & payload_mask) != 0ull; }
+	[[nodiscard]] constexpr auto as_number() const noexcept -> double { return std::bit_cast<double>(bits); }
+	[[nodiscard]] auto as_integral() const noexcept -> int64_t {
+		if (get_tag() == tag::wide_integral) return pointer<wide_integral_object>()->number;
+		return static_cast<int64_t>(bits << tag_width) >> tag_width;
+	}
+	/**
+	 * @warning Short strings live inside of the value, so the view is valid while the value is.
+	 * The view of a slice is valid until the next concatenation
+	 */
+	[[nodiscard]] auto as_string() const & noexcept -> std::string_view {
+		switch (get_tag()) {
+			case tag::short_string:
+				return std::string_view{
+					std::next(reinterpret_cast<const char *>(&bits), short_string_offset),
+					static_cast<size_t>(bits & 0xFFull)
+				};
+			case tag::slice: {
+				const auto &piece{ *pointer<slice_object>() };
+				return std::string_view{ std::data(piece.buffer->chars), piece.length };
+			}
+
+			default: break;
+		}
+		return pointer<string_object>()->chars;
+	}
+	auto as_string() const && -> std::string_view = delete;
+	/// Strings only. Interned strings might be compared by raw() instead of the content
+	[[nodiscard]] constexpr auto is_interned() const noexcept -> bool { return get_tag() != tag::slice; }
+
+	[[nodiscard]] constexpr auto raw() const noexcept -> uint64_t { return bits; }
+
+private:
+	friend class value_heap;
+
+	enum class tag : uint8_t {
+		null = 1,
+		boolean,
+		integral,
+		wide_integral,
+		string,
+		short_string,
+		slice,
+	};
+
+	/// The header of the objects referred by the values: the count of the values referring to it
+	struct object {
+		uint32_t references{ 1u };
+	};
+	struct wide_integral_object : object {
+		int64_t number{};
+	};
+	struct string_object;
+	/// The interned strings by their content. The strings leave it when they're freed
+	using string_table = std::unordered_map<std::string_view, string_object *>;
+
+	struct string_object : object {
+		string_table *table{}; /// nullptr once the heap which interned the string is gone
+		std::string chars{};
+	};
+	/// The characters shared by the slices. The slices are the references of the buffer
+	struct buffer_object : object {
+		std::string chars{};
+	};
+	/// The prefix of the append buffer
+	struct slice_object : object {
+		buffer_object *buffer{};
+		size_t length{};
+	};
+
+	static constexpr uint64_t tagged_mask{ 0xFFF8'0000'0000'0000ull }; /// sign, exponent and quiet bits
+	static constexpr uint64_t canonical_nan{ 0x7FF8'0000'0000'0000ull };
+	static constexpr uint64_t payload_mask{ 0x0000'FFFF'FFFF'FFFFull };
+	static constexpr uint32_t payload_width{ 48u };
+	static constexpr uint32_t tag_width{ 64u - payload_width };
+	static constexpr int64_t max_inline_integral{ (1ll << (payload_width - 1u)) - 1ll };
+	static constexpr int64_t min_inline_integral{ -(1ll << (payload_width - 1u)) };
+
+	/// The lowest byte keeps the length. The characters follow it in memory order
+	static constexpr auto little_endian{ std::endian::native == std::endian::little };
+	static constexpr std::ptrdiff_t short_string_offset{ little_endian ? 1 : 2 };
+	[[nodiscard]] static constexpr auto char_shift(size_t index) noexcept -> uint32_t {
+		return static_cast<uint32_t>(little_endian ? 8u * (index + 1u) : 40u - 8u * index);
+	}
+
+	static constexpr uint64_t null_bits{ tagged_mask | (static_cast<uint64_t>(tag::null) << payload_width) };
+
+	uint64_t bits{ null_bits };
+
+	constexpr explicit value(uint64_t raw) noexcept : bits{ raw } {}
+	constexpr value(tag t, uint64_t payload) noexcept
+		: bits{ tagged_mask | (static_cast<uint64_t>(t) << payload_width) | payload } {}
+
+	[[nodiscard]] constexpr auto is_tagged() const noexcept -> bool { return (bits & tagged_mask) == tagged_mask; }
+	[[nodiscard]] constexpr auto get_tag() const noexcept -> tag {
+		return static_cast<tag>((bits >> payload_width) & 0b111ull);
+	}
+
+	/// Wide integers, interned strings and slices are the objects, the rest is stored in place
+	[[nodiscard]] constexpr auto is_object() const noexcept -> bool {
+		if (!is_tagged()) return false;
+
+		const auto t{ get_tag() };
+		return t == tag::wide_integral || t == tag::string || t == tag::slice;
+	}
+
+	template<class T>
+	[[nodiscard]] auto pointer() const noexcept -> T * {
+		return reinterpret_cast<T *>(static_cast<uintptr_t>(bits & payload_mask));
+	}
+
+	constexpr void retain() const noexcept {
+		if (is_object()) ++pointer<object>()->references;
+	}
+	constexpr void release() noexcept {
+		if (is_object() && --pointer<object>()->references == 0u) destroy();
+	}
+	/// Frees the object once the last value referring to it is gone
+	void destroy() noexcept;
+};
+
+static_assert(sizeof(value) == sizeof(uint64_t));
+
+/**
+ * @brief Maker of the strings and the wide integers referenced by values.
+ *
+ * The objects are freed along with the last value referring to them, the interned
+ * strings leave the intern table then. Values may outlive the heap. Moving the heap
+ * keeps its table, so the strings interned before the move stay unique.
+ *
+ * The concatenation appends to the buffer of the left slice when the slice is
+ * the whole buffer, so growing a string piece by piece takes linear time. Only
+ * the characters past every slice are written, so the shorter slices of the same
+ * buffer keep their content. When the left slice is the last one of its buffer,
+ * the characters past it belong to nobody and the buffer is cut back to reuse it.
+ */
+class LOX_EXPORT value_heap {
+public:
+	value_heap() = default;
+	value_heap(const value_heap &) = delete;
+	value_heap(value_heap &&) noexcept = default;
+	~value_heap();
+
+	auto operator=(const value_heap &) -> value_heap & = delete;
+	auto operator=(value_heap &&) noexcept -> value_heap & = default;
+
+	[[nodiscard]] auto integral(int64_t num) -> value;
+	/** @return the interned string or the short one */
+	[[nodiscard]] auto string(std::string_view str) -> value;
+	/** @warning Both values have to be strings */
+	[[nodiscard]] auto concat(const value lhv, const value rhv) -> value;
+	[[nodiscard]] auto make(const literal &lit) -> value;
+
+private:
+	std::unique_ptr<value::string_table> m_interned{ std::make_unique<value::string_table>() };
+
+	[[nodiscard]] static auto reference(value::tag t, const void *object) noexcept -> value;
+};
+
+[[nodiscard]] auto to_literal(const value val) -> literal;
+[[nodiscard]] auto to_string(const value val) -> std::string;
+
+} // namespace lox
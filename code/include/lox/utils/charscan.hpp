@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace lox::utils {
+
+/**
+ * @brief Character classes of the scanner. Unlike <cctype> they don't depend
+ * on the locale, and the bytes above 0x7F don't belong to any class.
+ */
+namespace char_class {
+
+constexpr uint8_t space{ 0b0001 };      /// ' ', '\t', '\n', '\v', '\f', '\r'
+constexpr uint8_t digit{ 0b0010 };      /// '0'-'9'
+constexpr uint8_t alpha{ 0b0100 };      /// 'a'-'z', 'A'-'Z'
+constexpr uint8_t underscore{ 0b1000 }; /// '_'
+constexpr uint8_t identifier{ digit | alpha | underscore };
+
+constexpr auto table{ [] {
+	std::array<uint8_t, 0x100> classes{};
+	for (const auto ch : std::string_view{ " \t\n\v\f\r" }) classes[static_cast<uint8_t>(ch)] = space;
+	for (size_t ch{ '0' }; ch <= '9'; ++ch) classes[ch] = digit;
+	for (size_t ch{ 'a' }; ch <= 'z'; ++ch) classes[ch] = alpha;
+	for (size_t ch{ 'A' }; ch <= 'Z'; ++ch) classes[ch] = alpha;
+	classes['_'] = underscore;
+	return classes;
+}() };
+
+[[nodiscard]] constexpr auto of(const char ch) noexcept -> uint8_t { return table[static_cast<uint8_t>(ch)]; }
+[[nodiscard]] constexpr auto is(const char ch, const uint8_t cls) noexcept -> bool { return (of(ch) & cls) != 0u; }
+
+} // namespace char_class
+
+struct scan_result {
+	size_t position{};
+	uint32_t new_lines{}; /// the count of '\n' before the position
+};
+
+/**
+ * Bulk scanning of the script. Every function checks 16 bytes per step
+ * when SSE2 is available and falls back to the class table otherwise.
+ * Each one starts from the `from` position and returns the size of the
+ * text when nothing was found.
+ */
+namespace charscan {
+
+/** @return the first byte which isn't a space */
+[[nodiscard]] auto skip_spaces(std::string_view text, size_t from) noexcept -> scan_result;
+
+/** @return the first byte which isn't an identifier one */
+[[nodiscard]] auto skip_identifier(std::string_view text, size_t from) noexcept -> size_t;
+
+/** @return the first `symbol` */
+[[nodiscard]] auto find(std::string_view text, size_t from, char symbol) noexcept -> scan_result;
+
+/**
+ * @return the first '/' or the first byte after '*'
+ * @warning `from` has to be greater than zero
+ */
+[[nodiscard]] auto find_comment_end(std::string_view text, size_t from) noexcept -> scan_result;
+
+} // namespace charscan
+
+} // namespace lox::utils
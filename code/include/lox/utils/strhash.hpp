@@ -26,6 +26,24 @@ template<std::integral CharT>
 	return fnv1a(std::span{ std::data(str), std::size(str) });
 }
 
+constexpr uint64_t offset_basis_64{ 0xCBF29CE484222325 };
+constexpr uint64_t FNV_prime_64{ 0x00000100000001B3 };
+
+/// The 64-bit variant for the tables where the collisions of fnv1a() are too likely
+template<std::integral T>
+[[nodiscard]] constexpr auto fnv1a_64(std::span<const T> bytes) noexcept -> uint64_t {
+	uint64_t hash{ offset_basis_64 };
+	for (const auto byte : bytes) {
+		hash = (hash ^ static_cast<uint64_t>(byte)) * FNV_prime_64;
+	}
+	return hash;
+}
+
+template<std::integral CharT>
+[[nodiscard]] constexpr auto fnv1a_64(const std::basic_string_view<CharT> str) noexcept -> uint64_t {
+	return fnv1a_64(std::span{ std::data(str), std::size(str) });
+}
+
 namespace fnv1a_literals {
 
 #pragma warning(push)
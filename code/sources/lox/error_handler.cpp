@@ -1,6 +1,7 @@
 #include <format>
 
 #include "lox/error_handler.hpp"
+#include "lox/types/line_index.hpp"
 
 namespace lox {
 
@@ -16,10 +17,10 @@ void error_handler::report(
 	}
 
 	if (!(std::empty(m_file.source_code) || m_lines.contains(record.line))) {
-		m_lines.try_emplace(record.line, take_line(m_file.source_code, record));
+		m_lines.try_emplace(record.line, take_line(record));
 	}
 
-	const auto from{ std::exchange(record.from, relative_to_line(m_file.source_code, record.from)) };
+	const auto from{ std::exchange(record.from, relative_to_line(record.from)) };
 	record.to = record.from + record.to - from;
 
 	m_errors.emplace_back(std::move(record));
@@ -51,24 +52,38 @@ void error_handler::clear() {
 	m_errors.clear();
 }
 
-auto error_handler::take_line(const std::string_view source, const error_record &record) const noexcept -> std::pmr::string {
-	const auto line_start_pos{ source.find_last_of(eol, record.from) };
+auto error_handler::take_line(const error_record &record) const noexcept -> std::pmr::string {
+	const auto line_start_pos{ last_line_end(record.from) };
 	const auto line_start{ line_start_pos != std::string_view::npos ? line_start_pos + 1u : 0u };
-	const auto line_end{ source.find_first_of(eol, record.to) };
+	const auto line_end{ next_line_end(record.to) };
 
-	const auto line{ source.substr(line_start,
+	const auto line{ m_file.source_code.substr(line_start,
 		line_end != std::string_view::npos ? line_end - line_start : line_end
 	) };
 
 	return std::pmr::string{ line, m_allocator };
 }
 
-auto error_handler::relative_to_line(const std::string_view src, uint32_t pos) -> uint16_t {
-	const size_t last_eol_pos{ src.find_last_of('\n', pos) };
+auto error_handler::relative_to_line(uint32_t pos) const noexcept -> uint16_t {
+	const size_t last_eol_pos{ last_line_end(pos) };
 	const size_t last_eol{ last_eol_pos != std::string_view::npos ? last_eol_pos : 0u };
 	return static_cast<uint16_t>(pos - last_eol);
 }
 
+auto error_handler::last_line_end(const size_t pos) const noexcept -> size_t {
+	if (std::empty(m_line_ends)) {
+		return m_file.source_code.find_last_of(eol, pos);
+	}
+	return lox::last_line_end(m_line_ends, pos);
+}
+
+auto error_handler::next_line_end(const size_t pos) const noexcept -> size_t {
+	if (std::empty(m_line_ends)) {
+		return m_file.source_code.find_first_of(eol, pos);
+	}
+	return lox::next_line_end(m_line_ends, pos);
+}
+
 auto error_handler::code_value(const record_code code) noexcept -> uint32_t {
 	return std::visit([] (const auto value) noexcept { return static_cast<uint32_t>(value); }, code);
 }
@@ -0,0 +1,513 @@
+#include <format>
+#include <limits>
+#include <algorithm>
+
+#include "lox/execution/compiler.hpp"
+
+namespace lox::execution {
+
+namespace {
+
+auto to_opcode(token_type type) noexcept -> bytecode::opcode {
+	switch (type) {
+		using enum token_type;
+
+		case plus:          return bytecode::opcode::add;
+		case minus:         return bytecode::opcode::subtract;
+		case star:          return bytecode::opcode::multiply;
+		case slash:         return bytecode::opcode::divide;
+		case equal_equal:   return bytecode::opcode::equal;
+		case bang_equal:    return bytecode::opcode::not_equal;
+		case less:          return bytecode::opcode::less;
+		case less_equal:    return bytecode::opcode::less_equal;
+		case greater:       return bytecode::opcode::greater;
+		case greater_equal: return bytecode::opcode::greater_equal;
+
+		default: break;
+	}
+	return bytecode::opcode::binary;
+}
+
+} // namespace
+
+compiler::compiler(const program &prog, const lexeme_database &lexemes, error_handler &handler) noexcept
+	: prog{ prog }, lexemes{ lexemes }, errout{ handler } {}
+
+auto compiler::compile() -> tl::expected<bytecode::module, status> {
+	m_module = bytecode::module{};
+	m_failed = false;
+	m_states.clear();
+	m_states.emplace_back(bytecode::module::script_id, 0u);
+
+	for (const auto &stmt : prog.get()) {
+		compile(stmt);
+	}
+
+	emit(bytecode::opcode::null);
+	emit(bytecode::opcode::ret);
+
+	m_states.clear();
+	if (m_failed) {
+		return tl::unexpected{ status::invalid_program };
+	}
+	return std::move(m_module);
+}
+
+#pragma region expression::visitor_interface methods
+
+void compiler::accept(const expression_unary &unary) {
+	if (std::empty(unary.expr)) {
+		emit_report(error_code::ee_missing_expression, "", &unary.op);
+	}
+
+	compile(unary.expr);
+	emit(bytecode::opcode::unary);
+	emit_u32(add_token(unary.op));
+}
+
+void compiler::accept(const expression_incdec &incdec) {
+	const auto id{ incdec.name.lexeme_id };
+	const auto tok{ add_token(incdec.name) };
+	const auto op{ add_token(incdec.op) };
+
+	switch (const auto [kind, slot, constant]{ resolve(id, incdec.target) }; kind) {
+		case storage::local:
+			emit(bytecode::opcode::incdec_local);
+			emit_u16(slot);
+			emit_u32(tok);
+			emit_u32(op);
+			emit_u8(static_cast<uint8_t>(constant));
+			break;
+
+		case storage::dynamic:
+			emit(bytecode::opcode::incdec_dynamic);
+			emit_u32(static_cast<uint32_t>(id));
+			emit_u32(tok);
+			emit_u32(op);
+			break;
+
+		case storage::global:
+			emit(bytecode::opcode::incdec_global);
+			emit_u32(static_cast<uint32_t>(id));
+			emit_u32(tok);
+			emit_u32(op);
+			break;
+	}
+}
+
+void compiler::accept(const expression_assignment &assign) {
+	compile(assign.value);
+
+	const auto id{ assign.name.lexeme_id };
+	switch (const auto [kind, slot, constant]{ resolve(id, assign.target) }; kind) {
+		case storage::local:
+			if (constant) {
+				emit_report(error_code::ee_constant_assignment, std::format(
+					R"(Attempt to assign "{}" constant)", lexemes.get().get(id)
+				), &assign.name);
+				break;
+			}
+			emit(bytecode::opcode::set_local);
+			emit_u16(slot);
+			break;
+
+		case storage::dynamic:
+			emit(bytecode::opcode::set_dynamic);
+			emit_u32(static_cast<uint32_t>(id));
+			emit_u32(add_token(assign.name));
+			break;
+
+		case storage::global:
+			emit(bytecode::opcode::set_global);
+			emit_u32(static_cast<uint32_t>(id));
+			emit_u32(add_token(assign.name));
+			break;
+	}
+}
+
+void compiler::accept(const expression_binary &expr) {
+	if (std::empty(expr.left) || std::empty(expr.right)) {
+		emit_report(error_code::ee_missing_expression, "", &expr.op);
+	}
+
+	compile(expr.left);
+	compile(expr.right);
+	emit(to_opcode(expr.op.type));
+	emit_u32(add_token(expr.op));
+}
+
+void compiler::accept(const expression_call &call) {
+	compile(call.caller);
+
+	if (std::size(call.args) > (std::numeric_limits<uint16_t>::max)()) {
+		fail(error_code::ce_too_many_arguments, "Too many arguments in one call", call.paren);
+		return;
+	}
+
+	const auto count{ static_cast<uint16_t>(std::size(call.args)) };
+	emit(bytecode::opcode::check_call);
+	emit_u16(count);
+	emit_u32(add_token(call.paren));
+	const auto skip{ std::size(code()) };
+	emit_u32(0u);
+
+	for (const auto arg : prog.get().get(call.args)) {
+		compile(arg);
+	}
+
+	emit(bytecode::opcode::call);
+	emit_u16(count);
+	patch_jump(skip);
+}
+
+void compiler::accept(const expression_grouping &group) {
+	if (std::empty(group.expr)) {
+		emit_report(error_code::ee_missing_expression, "");
+	}
+	compile(group.expr);
+}
+
+void compiler::accept(const expression_literal &value) {
+	emit(bytecode::opcode::constant);
+	emit_u32(add_constant(prog.get().get(value.value)));
+}
+
+void compiler::accept(const expression_logical &logic) {
+	compile(logic.left);
+
+	switch (logic.op.type) {
+		case token_type::kw_or: {
+			const auto end{ emit_jump(bytecode::opcode::logical_or) };
+			compile(logic.right);
+			patch_jump(end);
+		} break;
+
+		case token_type::kw_and: {
+			const auto end{ emit_jump(bytecode::opcode::logical_and) };
+			compile(logic.right);
+			patch_jump(end);
+		} break;
+
+		default:
+			emit(bytecode::opcode::pop);
+			emit(bytecode::opcode::null);
+			break;
+	}
+}
+
+void compiler::accept(const expression_identifier &id) {
+	const auto lexeme{ id.name.lexeme_id };
+	switch (const auto [kind, slot, _]{ resolve(lexeme, id.target) }; kind) {
+		case storage::local:
+			emit(bytecode::opcode::get_local);
+			emit_u16(slot);
+			break;
+
+		case storage::dynamic:
+			emit(bytecode::opcode::get_dynamic);
+			emit_u32(static_cast<uint32_t>(lexeme));
+			emit_u32(add_token(id.name));
+			break;
+
+		case storage::global:
+			emit(bytecode::opcode::get_global);
+			emit_u32(static_cast<uint32_t>(lexeme));
+			emit_u32(add_token(id.name));
+			break;
+	}
+}
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+void compiler::accept(const statement_scope &scope) {
+	begin_scope();
+	for (const auto &statement : prog.get().get(scope.statements)) {
+		compile(statement);
+	}
+	end_scope();
+}
+
+void compiler::accept(const statement_expression &expr) {
+	if (std::empty(expr.expr)) {
+		emit_report(error_code::ee_missing_expression, "");
+		return;
+	}
+
+	compile(expr.expr);
+	emit(bytecode::opcode::pop);
+}
+
+void compiler::accept(const statement_function &func) {
+	const auto prototype{ std::size(m_module.functions) };
+	auto &function{ m_module.functions.emplace_back() };
+	function.name = func.name;
+	function.arity = static_cast<uint32_t>(std::size(func.params));
+
+	m_states.emplace_back(prototype, 1u);
+	for (const auto &param : prog.get().get(func.params)) {
+		/// The first parameter wins just like environment::define_variable does
+		const auto shadowed{ declared_in_scope(param.lexeme_id) };
+		const auto name{ shadowed ? lexeme_database::npos : param.lexeme_id };
+		m_module.functions[prototype].parameters.emplace_back(name);
+		declare_local(name, false, param);
+	}
+
+	compile(func.body);
+	emit(bytecode::opcode::null);
+	emit(bytecode::opcode::ret);
+	m_states.pop_back();
+
+	emit(bytecode::opcode::function);
+	emit_u32(static_cast<uint32_t>(prototype));
+
+	const auto id{ func.name.lexeme_id };
+	if (state().scope_depth == 0u) {
+		emit(bytecode::opcode::define_global);
+		emit_u32(static_cast<uint32_t>(id));
+		emit_u8(1u);
+		return;
+	}
+
+	if (declared_in_scope(id)) {
+		emit(bytecode::opcode::pop);
+		return;
+	}
+
+	declare_local(id, true, func.name);
+	emit(bytecode::opcode::define_local);
+	emit_u32(static_cast<uint32_t>(id));
+	emit_u8(1u);
+}
+
+void compiler::accept(const statement_branch &branch) {
+	compile(branch.condition);
+	const auto otherwise{ emit_jump(bytecode::opcode::jump_if_false) };
+
+	compile(branch.then_branch);
+
+	if (std::empty(branch.else_branch)) {
+		patch_jump(otherwise);
+		return;
+	}
+
+	const auto end{ emit_jump(bytecode::opcode::jump) };
+	patch_jump(otherwise);
+	compile(branch.else_branch);
+	patch_jump(end);
+}
+
+void compiler::accept(const statement_variable &var) {
+	define_storage(var.identifier, false, var.initializer, "Variable");
+}
+
+void compiler::accept(const statement_constant &con) {
+	define_storage(con.identifier, true, con.initializer, "Constant");
+}
+
+void compiler::accept(const statement_loop &loop) {
+	const auto start{ std::size(code()) };
+	compile(loop.condition);
+	const auto exit{ emit_jump(bytecode::opcode::jump_if_false) };
+
+	compile(loop.body);
+	emit_loop(start);
+	patch_jump(exit);
+}
+
+void compiler::accept(const statement_ret &ret) {
+	/// The virtual machine drops the locals of the frame on its own
+	compile(ret.value);
+	emit(bytecode::opcode::ret);
+}
+
+#pragma endregion statement::visitor_interface methods
+
+void compiler::compile(statement_id stmt) {
+	if (std::empty(stmt)) return;
+	prog.get().accept(*this, stmt);
+}
+
+void compiler::compile(expression_id expr) {
+	if (std::empty(expr)) {
+		emit(bytecode::opcode::null);
+		return;
+	}
+	prog.get().accept(*this, expr);
+}
+
+void compiler::begin_scope() {
+	++state().scope_depth;
+}
+
+void compiler::end_scope() {
+	auto &current{ state() };
+	const auto depth{ --current.scope_depth };
+
+	auto &locals{ current.locals };
+	const auto first_dropped{ std::ranges::find_if(locals, [depth](const local &l) {
+		return l.depth > depth;
+	}) };
+
+	if (const auto count{ std::distance(first_dropped, std::end(locals)) }; count > 0) {
+		locals.erase(first_dropped, std::end(locals));
+		emit(bytecode::opcode::pop_locals);
+		emit_u16(static_cast<uint16_t>(count));
+	}
+}
+
+auto compiler::declared_in_scope(lexeme_id name) const noexcept -> bool {
+	const auto &current{ state() };
+	for (auto it{ std::rbegin(current.locals) }; it != std::rend(current.locals); ++it) {
+		if (it->depth < current.scope_depth) break;
+		if (it->name == name) return true;
+	}
+	return false;
+}
+
+void compiler::declare_local(lexeme_id name, bool constant, const token &tok) {
+	auto &locals{ state().locals };
+	if (std::size(locals) > (std::numeric_limits<uint16_t>::max)()) {
+		fail(error_code::ce_too_many_locals, "Too many local variables in one function", tok);
+		return;
+	}
+	locals.emplace_back(name, state().scope_depth, constant);
+}
+
+void compiler::define_storage(const token &name, bool constant, expression_id initializer, std::string_view kind) {
+	const auto id{ name.lexeme_id };
+	const auto report_missing_initializer{ [&] {
+		if (constant && std::empty(initializer)) {
+			emit_report(error_code::ee_missing_expression, std::format(
+				R"(Constant "{}" wasn't initialized)", lexemes.get().get(id)
+			), &name);
+		}
+	} };
+
+	if (state().scope_depth == 0u) {
+		emit(bytecode::opcode::declare_global);
+		emit_u32(static_cast<uint32_t>(id));
+		emit_u32(add_token(name));
+		emit_u8(static_cast<uint8_t>(constant));
+
+		report_missing_initializer();
+		compile(initializer);
+
+		emit(bytecode::opcode::define_global);
+		emit_u32(static_cast<uint32_t>(id));
+		emit_u8(static_cast<uint8_t>(constant));
+		return;
+	}
+
+	if (declared_in_scope(id)) {
+		emit_report(error_code::ee_identifier_already_exists, std::format(
+			R"({} "{}" is already defined)", kind, lexemes.get().get(id)
+		), &name);
+
+		report_missing_initializer();
+		compile(initializer);
+		emit(bytecode::opcode::pop);
+		return;
+	}
+
+	report_missing_initializer();
+	compile(initializer);
+
+	declare_local(id, constant, name);
+	emit(bytecode::opcode::define_local);
+	emit_u32(static_cast<uint32_t>(id));
+	emit_u8(static_cast<uint8_t>(constant));
+}
+
+auto compiler::resolve(lexeme_id name, coordinates target) const noexcept -> resolution {
+	const auto &locals{ state().locals };
+	for (size_t slot{ std::size(locals) }; slot > 0ull; --slot) {
+		if (const auto &l{ locals[slot - 1ull] }; l.name == name) {
+			return resolution{ storage::local, static_cast<uint16_t>(slot - 1ull), l.constant };
+		}
+	}
+
+	/// Functions see the locals of their callers, so only a name no caller might bind is a global
+	return resolution{ target.storage == coordinates::kind::global ? storage::global : storage::dynamic };
+}
+
+void compiler::emit(bytecode::opcode op) {
+	code().emplace_back(static_cast<uint8_t>(op));
+}
+
+void compiler::emit_u8(uint8_t value) {
+	code().emplace_back(value);
+}
+
+void compiler::emit_u16(uint16_t value) {
+	bytecode::write(code(), value);
+}
+
+void compiler::emit_u32(uint32_t value) {
+	bytecode::write(code(), value);
+}
+
+auto compiler::emit_jump(bytecode::opcode op) -> size_t {
+	emit(op);
+	const auto operand{ std::size(code()) };
+	emit_u32(0u);
+	return operand;
+}
+
+void compiler::patch_jump(size_t operand) {
+	auto &bytes{ code() };
+	const auto offset{ static_cast<uint32_t>(std::size(bytes) - operand - sizeof(uint32_t)) };
+	std::memcpy(std::next(std::data(bytes), static_cast<std::ptrdiff_t>(operand)), &offset, sizeof(offset));
+}
+
+void compiler::emit_loop(size_t start) {
+	emit(bytecode::opcode::loop);
+	emit_u32(static_cast<uint32_t>(std::size(code()) + sizeof(uint32_t) - start));
+}
+
+void compiler::emit_report(error_code err_no, std::string message, const token *tok) {
+	const auto id{ static_cast<uint32_t>(std::size(m_module.messages)) };
+	m_module.messages.emplace_back(std::move(message));
+
+	emit(bytecode::opcode::report);
+	emit_u32(static_cast<uint32_t>(err_no));
+	emit_u32(id);
+	emit_u32(tok != nullptr ? add_token(*tok) : bytecode::no_token);
+}
+
+void compiler::fail(error_code err_no, std::string_view message, const token &tok) {
+	m_failed = true;
+	errout.get().report(message, error_record{
+		.code = err_no,
+		.line = tok.line,
+		.from = tok.position,
+		.to   = tok.position + 1u
+	});
+}
+
+auto compiler::add_constant(literal value) -> uint32_t {
+	const auto id{ static_cast<uint32_t>(std::size(m_module.constants)) };
+	m_module.constants.emplace_back(std::move(value));
+	return id;
+}
+
+auto compiler::add_token(const token &tok) -> uint32_t {
+	const auto id{ static_cast<uint32_t>(std::size(m_module.tokens)) };
+	m_module.tokens.emplace_back(tok);
+	return id;
+}
+
+auto compiler::state() noexcept -> function_state & {
+	return m_states.back();
+}
+
+auto compiler::state() const noexcept -> const function_state & {
+	return m_states.back();
+}
+
+auto compiler::code() noexcept -> std::vector<uint8_t> & {
+	return m_module.functions[state().prototype].code;
+}
+
+} // namespace lox::execution
@@ -0,0 +1,315 @@
+#include <limits>
+
+#include "lox/execution/constant_folder.hpp"
+#include "lox/execution/operators.hpp"
+
+namespace lox::execution {
+
+namespace {
+
+/** @return true when the engines would overflow or divide by zero computing the integers */
+[[nodiscard]] auto is_undefined(token_type op, const int64_t lhv, const int64_t rhv) noexcept -> bool {
+	constexpr auto min{ (std::numeric_limits<int64_t>::min)() };
+	constexpr auto max{ (std::numeric_limits<int64_t>::max)() };
+
+	switch (op) {
+		using enum token_type;
+
+		case plus:  return rhv > 0 ? lhv > max - rhv : lhv < min - rhv;
+		case minus: return rhv < 0 ? lhv > max + rhv : lhv < min + rhv;
+		case slash: return rhv == 0 || (lhv == min && rhv == -1);
+		case star:
+			if (lhv == 0 || rhv == 0) return false;
+			if (lhv > 0) return rhv > 0 ? lhv > max / rhv : rhv < min / lhv;
+			return rhv > 0 ? lhv < min / rhv : rhv < max / lhv;
+
+		default: break;
+	}
+	return false;
+}
+
+} // namespace
+
+constant_folder::constant_folder(program &prog, const environment &globals) : prog{ prog } {
+	globals.for_each_binding([this](lexeme_id name, value, bool) {
+		++m_bindings[name];
+	});
+	count_bindings();
+}
+
+void constant_folder::fold() {
+	for (auto &stmt : prog.get()) {
+		stmt = fold(stmt);
+	}
+	prog.get().relayout();
+}
+
+#pragma region expression::visitor_interface methods
+
+auto constant_folder::accept(const expression_unary &unary) -> expression_id {
+	const auto self{ m_current_expression };
+	auto &node{ prog.get().get_expressions<expression_type::unary>(self) };
+	node.expr = fold(unary.expr);
+
+	auto val{ value_of(node.expr) };
+	if (!val.has_value() || !operators::is_suitable_for(node.op.type, val->type())) {
+		return self;
+	}
+
+	switch (node.op.type) {
+		case token_type::minus:
+			if (val->is(literal_type::integral) && val->as_integral() == (std::numeric_limits<int64_t>::min)()) {
+				return self;
+			}
+			return operators::negate_number(m_heap, *val) ? make_literal(*val) : self;
+
+		case token_type::bang:
+			return operators::inverse_boolean(*val) ? make_literal(*val) : self;
+
+		default: break;
+	}
+	return self;
+}
+
+auto constant_folder::accept(const expression_incdec &) -> expression_id {
+	return m_current_expression;
+}
+
+auto constant_folder::accept(const expression_assignment &assign) -> expression_id {
+	const auto self{ m_current_expression };
+	prog.get().get_expressions<expression_type::assignment>(self).value = fold(assign.value);
+	return self;
+}
+
+auto constant_folder::accept(const expression_binary &binary) -> expression_id {
+	const auto self{ m_current_expression };
+	auto &node{ prog.get().get_expressions<expression_type::binary>(self) };
+	node.left = fold(binary.left);
+	node.right = fold(binary.right);
+
+	const auto lhv{ value_of(node.left) };
+	const auto rhv{ value_of(node.right) };
+	if (!lhv.has_value() || !rhv.has_value()) {
+		return self;
+	}
+
+	if (lhv->is(literal_type::integral) && rhv->is(literal_type::integral)
+		&& is_undefined(node.op.type, lhv->as_integral(), rhv->as_integral())) {
+		return self;
+	}
+
+	if (const auto result{ operators::binary(m_heap, node.op.type, *lhv, *rhv) }; result.has_value()) {
+		return make_literal(result.value());
+	}
+	return self;
+}
+
+auto constant_folder::accept(const expression_call &call) -> expression_id {
+	const auto self{ m_current_expression };
+	auto &node{ prog.get().get_expressions<expression_type::call>(self) };
+	node.caller = fold(call.caller);
+	for (auto &arg : prog.get().get(node.args)) {
+		arg = fold(arg);
+	}
+	return self;
+}
+
+auto constant_folder::accept(const expression_grouping &group) -> expression_id {
+	const auto self{ m_current_expression };
+	const auto inner{ fold(group.expr) };
+	if (value_of(inner).has_value()) {
+		return inner;
+	}
+
+	prog.get().get_expressions<expression_type::grouping>(self).expr = inner;
+	return self;
+}
+
+auto constant_folder::accept(const expression_literal &) -> expression_id {
+	return m_current_expression;
+}
+
+auto constant_folder::accept(const expression_logical &logic) -> expression_id {
+	const auto self{ m_current_expression };
+	auto &node{ prog.get().get_expressions<expression_type::logical>(self) };
+	node.left = fold(logic.left);
+
+	/// The left side decides alone, the right one becomes the result otherwise
+	const auto is_or{ node.op.type == token_type::kw_or };
+	if (const auto lhv{ value_of(node.left) };
+		lhv.has_value() && !std::empty(node.right) && (is_or || node.op.type == token_type::kw_and)) {
+		if (const auto truth{ operators::is_truth(*lhv) }; truth.has_value()) {
+			return truth.value() == is_or ? make_literal(value::null()) : fold(node.right);
+		}
+	}
+
+	node.right = fold(node.right);
+	return self;
+}
+
+auto constant_folder::accept(const expression_identifier &id) -> expression_id {
+	if (const auto found{ m_constants.find(id.name.lexeme_id) }; found != std::end(m_constants)) {
+		if (const auto &con{ found->second }; con.global || con.function == m_function) {
+			return con.value;
+		}
+	}
+	return m_current_expression;
+}
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+auto constant_folder::accept(const statement_scope &scope) -> statement_id {
+	const auto self{ m_current_statement };
+	begin_scope();
+	for (auto &statement : prog.get().get(scope.statements)) {
+		statement = fold(statement);
+	}
+	end_scope();
+	return self;
+}
+
+auto constant_folder::accept(const statement_expression &expr) -> statement_id {
+	const auto self{ m_current_statement };
+	if (std::empty(expr.expr)) {
+		return self;
+	}
+
+	const auto folded{ fold(expr.expr) };
+	if (value_of(folded).has_value()) {
+		return statement_id{};
+	}
+
+	prog.get().get_statements<statement_type::expression>(self).expr = folded;
+	return self;
+}
+
+auto constant_folder::accept(const statement_function &func) -> statement_id {
+	const auto self{ m_current_statement };
+	const auto enclosing_function{ std::exchange(m_function, ++m_functions_count) };
+	const auto body{ fold(func.body) };
+	m_function = enclosing_function;
+
+	prog.get().get_statements<statement_type::function>(self).body = body;
+	return self;
+}
+
+auto constant_folder::accept(const statement_branch &branch) -> statement_id {
+	const auto self{ m_current_statement };
+	auto &node{ prog.get().get_statements<statement_type::branch>(self) };
+	node.condition = fold(branch.condition);
+
+	if (const auto condition{ value_of(node.condition) }; condition.has_value()) {
+		if (const auto truth{ operators::is_truth(*condition) }; truth.has_value()) {
+			return fold(truth.value() ? node.then_branch : node.else_branch);
+		}
+	}
+
+	node.then_branch = fold(node.then_branch);
+	node.else_branch = fold(node.else_branch);
+	return self;
+}
+
+auto constant_folder::accept(const statement_variable &var) -> statement_id {
+	const auto self{ m_current_statement };
+	prog.get().get_statements<statement_type::variable>(self).initializer = fold(var.initializer);
+	return self;
+}
+
+auto constant_folder::accept(const statement_constant &con) -> statement_id {
+	const auto self{ m_current_statement };
+	const auto initializer{ fold(con.initializer) };
+	prog.get().get_statements<statement_type::constant>(self).initializer = initializer;
+
+	/// The declaration itself stays, so the engines still define the name
+	const auto name{ con.identifier.lexeme_id };
+	if (m_bindings[name] == 1u && value_of(initializer).has_value()) {
+		m_constants.insert_or_assign(name, constant{
+			.value    = initializer,
+			.function = m_function,
+			.global   = std::size(m_scopes) == 1u
+		});
+		m_scopes.back().emplace_back(name);
+	}
+	return self;
+}
+
+auto constant_folder::accept(const statement_loop &loop) -> statement_id {
+	const auto self{ m_current_statement };
+	auto &node{ prog.get().get_statements<statement_type::loop>(self) };
+	node.condition = fold(loop.condition);
+
+	if (const auto condition{ value_of(node.condition) }; condition.has_value()) {
+		if (const auto truth{ operators::is_truth(*condition) }; truth.has_value() && !truth.value()) {
+			return statement_id{};
+		}
+	}
+
+	node.body = fold(node.body);
+	return self;
+}
+
+auto constant_folder::accept(const statement_ret &ret) -> statement_id {
+	const auto self{ m_current_statement };
+	prog.get().get_statements<statement_type::ret>(self).value = fold(ret.value);
+	return self;
+}
+
+#pragma endregion statement::visitor_interface methods
+
+auto constant_folder::fold(expression_id expr) -> expression_id {
+	if (std::empty(expr)) return expr;
+	m_current_expression = expr;
+	return prog.get().accept(*this, expr);
+}
+
+auto constant_folder::fold(statement_id stmt) -> statement_id {
+	if (std::empty(stmt)) return stmt;
+	m_current_statement = stmt;
+	return prog.get().accept(*this, stmt);
+}
+
+auto constant_folder::value_of(expression_id expr) -> std::optional<value> {
+	if (std::empty(expr) || expr.type() != expression_type::literal) {
+		return std::nullopt;
+	}
+
+	const auto &program{ prog.get() };
+	return m_heap.make(program.get(program.get_expressions<expression_type::literal>(expr).value));
+}
+
+auto constant_folder::make_literal(const value val) -> expression_id {
+	auto &program{ prog.get() };
+	return program.emplace<expression_type::literal>(program.store(to_literal(val)));
+}
+
+void constant_folder::begin_scope() {
+	m_scopes.emplace_back();
+}
+
+void constant_folder::end_scope() {
+	for (const auto name : m_scopes.back()) {
+		m_constants.erase(name);
+	}
+	m_scopes.pop_back();
+}
+
+void constant_folder::count_bindings() {
+	const auto &program{ prog.get() };
+
+	for (const auto &var : program.get_statements<statement_type::variable>()) {
+		++m_bindings[var.identifier.lexeme_id];
+	}
+	for (const auto &con : program.get_statements<statement_type::constant>()) {
+		++m_bindings[con.identifier.lexeme_id];
+	}
+	for (const auto &func : program.get_statements<statement_type::function>()) {
+		++m_bindings[func.name.lexeme_id];
+		for (const auto &param : program.get(func.params)) {
+			++m_bindings[param.lexeme_id];
+		}
+	}
+}
+
+} // namespace lox::execution
@@ -0,0 +1,26 @@
+#include "lox/execution/engine.hpp"
+#include "lox/execution/compiler.hpp"
+#include "lox/execution/interpreter.hpp"
+#include "lox/execution/virtual_machine.hpp"
+
+namespace lox::execution {
+
+auto run(engine type, environment env, const program &prog, const lexeme_database &lexemes, error_handler &handler) -> status {
+	switch (type) {
+		case engine::tree_walker:
+			return interpreter{ std::move(env), prog, lexemes, handler }.run();
+
+		case engine::bytecode: {
+			const auto mod{ compiler{ prog, lexemes, handler }.compile() };
+			if (!mod.has_value()) {
+				return mod.error();
+			}
+			return virtual_machine{ std::move(env), *mod, lexemes, handler }.run();
+		}
+
+		default: break;
+	}
+	return status::invalid_program;
+}
+
+} // namespace lox::execution
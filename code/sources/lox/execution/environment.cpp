@@ -18,12 +18,12 @@ void environment::pop_scope() {
 }
 
 
-auto environment::define_variable(lexeme_id id, lox::literal value) -> bool {
-	return push_value(id, std::move(value), mutability::variable);
+auto environment::define_variable(lexeme_id id, lox::value value, coordinates where) -> bool {
+	return push_value(id, std::move(value), mutability::variable, where);
 }
 
-auto environment::define_constant(lexeme_id id, lox::literal value) -> bool {
-	return push_value(id, std::move(value), mutability::constant);
+auto environment::define_constant(lexeme_id id, lox::value value, coordinates where) -> bool {
+	return push_value(id, std::move(value), mutability::constant, where);
 }
 
 auto environment::contains(lexeme_id id, search_range::globally_type) const noexcept -> bool {
@@ -39,7 +39,16 @@ auto environment::contains(lexeme_id id, search_range::current_scope_type) const
 	return std::find(std::rbegin(m_keys), end, id) != end;
 }
 
-auto environment::look_up(lexeme_id id) const -> const lox::literal & {
+auto environment::contains(lexeme_id id, coordinates where) const noexcept -> bool {
+	/// The resolver gives a slot to the first definition of the name in the scope only.
+	/// A slot which doesn't match means the program was resolved against another environment
+	if (!where.empty() && get_rewind_point() + where.slot == std::size(m_keys)) {
+		return false;
+	}
+	return contains(id);
+}
+
+auto environment::look_up(lexeme_id id) const -> const lox::value & {
 	if (const auto index{ index_of(id) }; index >= 0ll) {
 		return m_values[index].value;
 	}
@@ -47,43 +56,43 @@ auto environment::look_up(lexeme_id id) const -> const lox::literal & {
 	throw std::out_of_range{ R"(Undefined variable or constant)" };
 }
 
-auto environment::assign(lexeme_id id, lox::literal value) noexcept -> assignment_status {
-	const auto index{ index_of(id) };
-	if (index < 0ll) {
-		return assignment_status::not_found;
+auto environment::look_up(lexeme_id id, coordinates where) const noexcept -> const lox::value * {
+	if (const auto index{ index_of(id, where) }; index >= 0ll) {
+		return &m_values[index].value;
 	}
+	return nullptr;
+}
 
-	if (auto &container{ m_values[index] }; container.type == mutability::variable) {
-		container.value = std::move(value);
-		return assignment_status::ok;
-	}
+auto environment::assign(lexeme_id id, lox::value value) noexcept -> assignment_status {
+	return assign_at(index_of(id), std::move(value));
+}
 
-	return assignment_status::constant;
+auto environment::assign(lexeme_id id, coordinates where, lox::value value) noexcept -> assignment_status {
+	return assign_at(index_of(id, where), std::move(value));
 }
 
 auto environment::has_function(lexeme_id address) const noexcept -> bool {
 	if (!contains(address, search_range::globally)) return false;
 
-	if (const auto id{ look_up(address).as<int64_t>() }; id) {
-		return *id < std::size(m_functions);
+	if (const auto id{ look_up(address) }; id.is(literal_type::integral)) {
+		return static_cast<size_t>(id.as_integral()) < std::size(m_functions);
 	}
 
 	return false;
 }
 
 auto environment::get_function(lexeme_id address) const -> function {
-	return m_functions.at(std::get<int64_t>(look_up(address)));
+	return m_functions.at(static_cast<size_t>(look_up(address).as_integral()));
 }
 
-auto environment::register_function(lexeme_id address, function fun) -> bool {
-	const literal id{ static_cast<int64_t>(std::size(m_functions)) };
+auto environment::register_function(lexeme_id address, function fun, coordinates where) -> bool {
+	const auto id{ value::integral(static_cast<int64_t>(std::size(m_functions))) };
 	m_functions.emplace_back(fun);
-	return define_constant(address, id);
+	return define_constant(address, id, where);
 }
 
-auto environment::function_at(size_t id) const noexcept -> std::optional<function> {
-	if (id >= std::size(m_functions)) return std::nullopt;
-	return m_functions[id];
+auto environment::function_at(size_t id) const noexcept -> const function * {
+	return id < std::size(m_functions) ? &m_functions[id] : nullptr;
 }
 
 auto environment::index_of(lexeme_id id) const noexcept -> int64_t {
@@ -92,8 +101,36 @@ auto environment::index_of(lexeme_id id) const noexcept -> int64_t {
 	return index;
 }
 
-auto environment::push_value(lexeme_id id, lox::literal value, mutability type) -> bool {
-	if (contains(id)) {
+auto environment::index_of(lexeme_id id, coordinates where) const noexcept -> int64_t {
+	const auto scopes_count{ std::size(m_scopes) };
+	if (where.empty() || where.depth > scopes_count) {
+		return index_of(id);
+	}
+
+	const auto scope{ where.storage == coordinates::kind::global ? 0ull : scopes_count - where.depth };
+	if (const auto index{ scope_begin(scope) + where.slot }; index < scope_end(scope) && m_keys[index] == id) {
+		return static_cast<int64_t>(index);
+	}
+
+	/// The program was resolved against another environment. Keep it working anyway
+	return index_of(id);
+}
+
+auto environment::assign_at(int64_t index, lox::value value) noexcept -> assignment_status {
+	if (index < 0ll) {
+		return assignment_status::not_found;
+	}
+
+	if (auto &container{ m_values[index] }; container.type == mutability::variable) {
+		container.value = std::move(value);
+		return assignment_status::ok;
+	}
+
+	return assignment_status::constant;
+}
+
+auto environment::push_value(lexeme_id id, lox::value value, mutability type, coordinates where) -> bool {
+	if (contains(id, where)) {
 		return false;
 	}
 
@@ -106,4 +143,12 @@ auto environment::get_rewind_point() const noexcept -> size_t {
 	return std::empty(m_scopes) ? 0ull : m_scopes.back();
 }
 
+auto environment::scope_begin(size_t scope) const noexcept -> size_t {
+	return scope == 0ull ? 0ull : m_scopes[scope - 1ull];
+}
+
+auto environment::scope_end(size_t scope) const noexcept -> size_t {
+	return scope < std::size(m_scopes) ? m_scopes[scope] : std::size(m_keys);
+}
+
 } // namespace lox::execution
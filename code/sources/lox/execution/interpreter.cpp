@@ -1,206 +1,124 @@
-#include <cmath>
-#include <limits>
-#include <format>
 #include <algorithm>
+#include <format>
 #include <functional>
 
 #if defined(LOX_DEBUG)
 #include <cstdio>
 #endif // defined(LOX_DEBUG)
 
-#include <tl/expected.hpp>
-
+#include "lox/constants.hpp"
 #include "lox/execution/interpreter.hpp"
-#include "lox/utils/compile_time.hpp"
+#include "lox/execution/operators.hpp"
 
 namespace lox::execution {
 
-namespace {
-
-using evaluation_result = tl::expected<literal, std::string>;
-
-auto make_no_operator_error(token_type op, const literal &lhv, const literal &rhv) -> std::string {
-	return std::format("No operator '{0}' for literals with types: '{1}' and '{2}':\n\t{3} {0} {4}",
-		token_string(op),
-		type_name(lhv.type()), type_name(rhv.type()),
-		to_string(lhv), to_string(rhv)
-	);
-}
-
-namespace traits {
-
-template<token_type Type>
-struct operation { using type = void; };
-
-template<> struct operation<token_type::plus>          { using type = std::plus<>;               };
-template<> struct operation<token_type::minus>         { using type = std::minus<>;              };
-template<> struct operation<token_type::star>          { using type = std::multiplies<>;         };
-template<> struct operation<token_type::slash>         { using type = std::divides<>;            };
-
-template<> struct operation<token_type::equal_equal>   { using type = std::equal_to<>;           };
-template<> struct operation<token_type::bang_equal>    { using type = std::not_equal_to<>;       };
-template<> struct operation<token_type::less>          { using type = std::less<>;               };
-template<> struct operation<token_type::less_equal>    { using type = std::less_equal<>;         };
-template<> struct operation<token_type::greater>       { using type = std::greater<>;            };
-template<> struct operation<token_type::greater_equal> { using type = std::greater_equal<>;      };
-
-} // namespace traits
-
-template<token_type Type, class Operation = traits::operation<Type>::type>
-auto eval_numeric(const literal &lhv, const literal &rhv) -> std::optional<literal> {
-	const Operation oper{};
-	if (auto integer{ lhv.as<int64_t>() }; integer) {
-		if (rhv.is(literal_type::integral)) {
-			return oper(*integer, std::get<int64_t>(rhv));
-		}
-		if (rhv.is(literal_type::number)) {
-			return oper(static_cast<double>(*integer), std::get<double>(rhv));
-		}
-	} else if (auto num{ lhv.as<double>() }; num) {
-		if (rhv.is(literal_type::number)) {
-			return oper(*num, std::get<double>(rhv));
-		}
-		if (rhv.is(literal_type::integral)) {
-			return oper(*num, static_cast<double>(std::get<int64_t>(rhv)));
-		}
-	}
-	return std::nullopt;
-}
-
-
-
-template<token_type Type, class Operation = traits::operation<Type>::type>
-auto compare(const literal &lhv, const literal &rhv) noexcept -> evaluation_result {
-	const Operation oper{};
-	if (auto value{ eval_numeric<Type, Operation>(lhv, rhv) }; value.has_value()) {
-		return std::move(value).value();
-	} else if (lhv.is(literal_type::string) && rhv.is(literal_type::string)) {
-		return oper(lhv, rhv);
-	}
-
-	return tl::make_unexpected(make_no_operator_error(Type, lhv, rhv));
-}
-
-
-template<token_type Operation>
-struct operation {
-	[[nodiscard]]
-	static auto eval(const literal &lhv, const literal &rhv) noexcept -> evaluation_result {
-		if constexpr (token_traits::is_arithmetic_v<Operation>) {
-			if (auto value{ eval_numeric<Operation>(lhv, rhv) }; value.has_value()) {
-				return std::move(value).value();
-			}
-
-			return tl::make_unexpected(make_no_operator_error(Operation, lhv, rhv));
-		} else if constexpr (token_traits::is_logical_v<Operation>) {
-			return compare<Operation>(lhv, rhv);
-		} else {
-			return tl::make_unexpected(std::format("Unsupported token '{}' (aka '{}')",
-				token_string(Operation), token_name(Operation)
-			));
-		}
-	}
-};
-
-template<>
-struct operation<token_type::plus> {
-	[[nodiscard]]
-	static auto eval(const literal &lhv, const literal &rhv) noexcept -> evaluation_result {
-		if (auto value{ eval_numeric<token_type::plus>(lhv, rhv) }; value.has_value()) {
-			return std::move(value).value();
-		}
-
-		if (lhv.is(literal_type::string) && rhv.is(literal_type::string)) {
-			return concat(std::get<std::string>(lhv), std::get<std::string>(rhv));
-		}
-
-		return tl::make_unexpected(make_no_operator_error(token_type::plus, lhv, rhv));
-	}
-
-	[[nodiscard]]
-	static auto concat(std::string_view lhv, std::string_view rhv) -> std::string {
-		std::string result(std::size(lhv) + std::size(rhv), '\0');
-		auto [_, pos]{ std::ranges::copy(lhv, std::begin(result)) };
-		std::ranges::copy(rhv, pos);
-		return result;
-	}
-};
-
-} // namespace
-
-
 interpreter::interpreter(
 	environment env,
 	const program &prog,
 	const lexeme_database &lexemes,
 	error_handler &handler
-) noexcept : m_env{ std::move(env) }, prog{ prog }, lexemes{ lexemes }, errout{ handler } {}
+) : m_env{ std::move(env) }, prog{ prog }, lexemes{ lexemes }, errout{ handler } {
+	m_stack.reserve(constants::initial_value_stack_size);
+
+	const auto &literals{ prog.get_expressions<expression_type::literal>() };
+	m_literals.reserve(std::size(literals));
+	for (const auto &lit : literals) {
+		m_literals.emplace_back(m_env.heap().make(prog.get(lit.value)));
+	}
+
+	m_binaries.resize(std::size(prog.get_expressions<expression_type::binary>()));
+	m_unaries.resize(std::size(prog.get_expressions<expression_type::unary>()));
+
+	/// A repeated parameter name keeps the first argument, so its definitions are checked by name
+	const auto &functions{ prog.get_statements<statement_type::function>() };
+	m_distinct_params.reserve(std::size(functions));
+	for (const auto &func : functions) {
+		const auto params{ prog.get(func.params) };
+		bool distinct{ true };
+		for (size_t i{ 1 }; distinct && i < std::size(params); ++i) {
+			distinct = std::none_of(std::begin(params), std::next(std::begin(params), static_cast<std::ptrdiff_t>(i)),
+				[&param = params[i]](const token &other) { return other.lexeme_id == param.lexeme_id; }
+			);
+		}
+		m_distinct_params.emplace_back(distinct);
+	}
+}
 
-auto interpreter::run() -> status try {
+auto interpreter::run() -> status {
 	for (const auto &stmt : prog.get()) {
-		execute(stmt);
+		/// The top-level return stops the script
+		if (execute(stmt) != completion::normal) break;
 	}
-	return status::ok;
-} catch (const execution_error &err) {
-	return err.reason;
+	return m_halted ? status::runtime_error : status::ok;
 }
 
-void interpreter::execute(statement_id stmt) {
-	if (std::empty(stmt)) return; /// @todo log error
+auto interpreter::execute(statement_id stmt) -> completion {
+	if (std::empty(stmt)) return completion::normal; /// @todo log error
 	// if (!prog.get().contains(stmt)) return;
 
-	prog.get().accept(*this, stmt);
+	const auto result{ prog.get().accept(*this, stmt) };
+	return m_halted ? completion::halting : result;
 }
 
-auto interpreter::evaluate(expression_id expr) -> literal try {
-	if (std::empty(expr)) return null_literal; /// @todo log error
+auto interpreter::evaluate(expression_id expr) -> value {
+	if (std::empty(expr) || m_halted) return value::null(); /// @todo log error
 
 	return prog.get().accept(*this, expr);
-} catch (const execution_error &) {
-	return null_literal;
 }
 
 #pragma region expression::visitor_interface methods
 
-auto interpreter::accept(const expression_unary &unary) -> literal {
+auto interpreter::accept(const expression_unary &unary) -> value {
 	if (std::empty(unary.expr)) {
 		error(error_code::ee_missing_expression, "", unary.op);
 	}
 
-	auto value{ evaluate(unary.expr) };
-	if (!is_suitable_for(unary.op.type, value.type())) {
-		throw error_no_suitable(unary.op, value);
+	auto val{ evaluate(unary.expr) };
+
+	const auto &unaries{ prog.get().get_expressions<expression_type::unary>() };
+	auto &quick{ m_unaries[static_cast<size_t>(&unary - std::data(unaries))] };
+	if (const auto type{ val.type() }; quick.operands[0] != type) {
+		quick = { operators::specialize(unary.op.type, type), { type } };
+	}
+	if (quick.handler != nullptr) {
+		return quick.handler(m_env.heap(), val);
+	}
+
+	if (!operators::is_suitable_for(unary.op.type, val.type())) {
+		return error_no_suitable(unary.op, val);
 	}
 
 	switch (unary.op.type) {
 		using enum token_type;
 
 		case plus: break;
-		case minus: if (negate_number(value)) return value; break;
-		case bang:  if (inverse_boolean(value)) return value; break;
+		case minus: if (operators::negate_number(m_env.heap(), val)) return val; break;
+		case bang:  if (operators::inverse_boolean(val)) return val; break;
 
 		default:
-			return null_literal;
+			return value::null();
 	}
 
-	return null_literal;
+	return value::null();
 }
 
-auto interpreter::accept(const expression_call &call) -> literal {
+auto interpreter::accept(const expression_call &call) -> value {
 	const auto caller_address{ evaluate(call.caller) };
 	if (!caller_address.is(literal_type::integral)) {
 		/// @todo info
-		throw error(error_code::ee_invalid_callable, "Invalid callable expression", call.paren);
+		return error(error_code::ee_invalid_callable, "Invalid callable expression", call.paren);
 	}
 
-	auto function{ m_env.function_at(std::get<int64_t>(caller_address)) };
-	if (!function.has_value()) {
-		throw error(error_code::ee_callable_not_found, "Cannot find function", call.paren);
+	const auto found{ m_env.function_at(static_cast<size_t>(caller_address.as_integral())) };
+	if (found == nullptr) {
+		return error(error_code::ee_callable_not_found, "Cannot find function", call.paren);
 	}
 
-	if (!function->enough_arguments_count(std::size(call.args))) {
-		const auto arity{ function->arity() };
-		throw error(error_code::ee_invalid_arguments_cound,
+	/// The copy is cheap and stays valid while the callee registers its own functions
+	const auto function{ *found };
+	if (!function.enough_arguments_count(std::size(call.args))) {
+		const auto arity{ function.arity() };
+		return error(error_code::ee_invalid_arguments_cound,
 			std::format("Invalid count of arguments. Expected {}, but got {}",
 				(arity.has_value() ? std::to_string(*arity) : "variadic amount"), std::size(call.args)
 			),
@@ -208,217 +126,201 @@ auto interpreter::accept(const expression_call &call) -> literal {
 		);
 	}
 
-	std::vector<literal> params(std::size(call.args));
-	for (size_t i{}; i < std::size(params); ++i) {
-		params[i] = evaluate(call.args[i]);
+	if (!function.native() && m_frames_count >= constants::max_call_stack_depth) {
+		error(error_code::ee_stack_overflow, std::format(
+			"Stack overflow: more than {} calls in progress", constants::max_call_stack_depth - 1ull
+		), call.paren);
+		m_halted = true;
+		return value::null();
 	}
 
-	m_env.push_scope();
-	/// @todo aw shit. But there's no plans on this project anyway lol.
-	std::shared_ptr<void> defer{ nullptr, [&env{ m_env }](...){ env.pop_scope(); } };
-	return function->call(this, std::move(params));
+	/// The arguments are evaluated right into the value stack, so the call allocates nothing
+	const auto base{ std::size(m_stack) };
+	for (const auto arg : prog.get().get(call.args)) {
+		m_stack.emplace_back(evaluate(arg));
+	}
+
+	const std::span<const value> args{ std::next(std::data(m_stack), static_cast<std::ptrdiff_t>(base)), std::size(call.args) };
+	const auto result{ function.native() ? function.call(m_env.heap(), args) : invoke(function, args) };
+	m_stack.resize(base);
+	return result;
 }
 
-auto interpreter::accept(const expression_incdec &incdec) -> literal {
+auto interpreter::accept(const expression_incdec &incdec) -> value {
 	const auto id{ incdec.name.lexeme_id };
 
-	if (!m_env.contains(id, execution::search_range::globally)) {
-		error(error_code::ee_undefined_identifier, std::format(
+	const auto found{ m_env.look_up(id, incdec.target) };
+	if (found == nullptr) {
+		return error(error_code::ee_undefined_identifier, std::format(
 			R"(Undefined variable "{}")", lexemes.get().get(id)
 		), incdec.name);
 	}
 
-	const auto &value{ m_env.look_up(id) };
-	if (!is_suitable_for(incdec.op.type, value.type())) {
-		throw error_no_suitable(incdec.op, value);
-		return null_literal;
+	const auto val{ *found };
+	if (!operators::is_suitable_for(incdec.op.type, val.type())) {
+		return error_no_suitable(incdec.op, val);
 	}
 
-	auto assign_output{ [&name{ incdec.name }, this] (auto value) {
-		safe_assign(name, std::move(value));
-		return evaluation_result{};
-	} };
-	auto throw_error{ [this, &op{ incdec.op }] (const auto &msg) {
-		throw error(error_code::ee_runtime_error, msg, op);
-	} };
-
-	[op{ incdec.op.type }, &value] {
+	const auto result{ [op{ incdec.op.type }, &heap{ m_env.heap() }, val] {
 		switch (op) {
 			using enum token_type;
-			case increment: return operation<plus>::eval(value, literal{ 1 });
-			case decrement: return operation<minus>::eval(value, literal{ 1 });
+			case increment: return operators::binary(heap, plus, val, value::integral(1));
+			case decrement: return operators::binary(heap, minus, val, value::integral(1));
 			default: break;
 		}
 
-		return evaluation_result{ tl::make_unexpected(
-			std::format("Unknown operation '{}' ({})", token_string(op), token_name(op))
-		) };
-	}()
-		.and_then(std::move(assign_output))
-		.or_else(std::move(throw_error))
-	;
+		return evaluation_result{ tl::make_unexpected(operators::make_unknown_operation_error(op)) };
+	}() };
+
+	if (!result.has_value()) {
+		return error(error_code::ee_runtime_error, result.error(), incdec.op);
+	}
+
+	safe_assign(incdec.name, incdec.target, result.value());
+	return result.value();
 }
 
-auto interpreter::accept(const expression_assignment &assign) -> literal {
-	const auto literal{ evaluate(assign.value) };
-	safe_assign(assign.name, literal);
-	return literal;
+auto interpreter::accept(const expression_assignment &assign) -> value {
+	const auto val{ evaluate(assign.value) };
+	safe_assign(assign.name, assign.target, val);
+	return val;
 }
 
-auto interpreter::accept(const expression_binary &expr) -> literal {
+auto interpreter::accept(const expression_binary &expr) -> value {
 	if (std::empty(expr.left) || std::empty(expr.right)) {
 		/// @todo Add description
 		error(error_code::ee_missing_expression, "", expr.op);
 	}
 
-	auto lhv{ evaluate(expr.left) };
-	auto rhv{ evaluate(expr.right) };
-	if (!is_suitable_for(expr.op.type, lhv.type(), rhv.type())) {
-		throw error_no_suitable(expr.op, lhv, rhv);
-	}
-
-	auto throw_error{ [this, &op{ expr.op }] (const auto &msg) {
-		throw error(error_code::ee_runtime_error, msg, op);
-	} };
-
-	return [op{ expr.op.type }, &lhv, &rhv] {
-		switch (op) {
-			using enum token_type;
-
-			case plus:  return operation<plus>::eval(lhv, rhv);
-			case minus: return operation<minus>::eval(lhv, rhv);
-			case star:  return operation<star>::eval(lhv, rhv);
-			case slash: return operation<slash>::eval(lhv, rhv);
+	const auto lhv{ evaluate(expr.left) };
+	const auto rhv{ evaluate(expr.right) };
 
-			case equal_equal:   return operation<equal_equal>::eval(lhv, rhv);
-			case bang_equal:    return operation<bang_equal>::eval(lhv, rhv);
-			case less:          return operation<less>::eval(lhv, rhv);
-			case less_equal:    return operation<less_equal>::eval(lhv, rhv);
-			case greater:       return operation<greater>::eval(lhv, rhv);
-			case greater_equal: return operation<greater_equal>::eval(lhv, rhv);
+	/// Operand types rarely change, so the node keeps the handler of the last seen ones
+	const auto &binaries{ prog.get().get_expressions<expression_type::binary>() };
+	auto &quick{ m_binaries[static_cast<size_t>(&expr - std::data(binaries))] };
+	if (const std::array types{ lhv.type(), rhv.type() }; quick.operands != types) {
+		quick = { operators::specialize(expr.op.type, types[0], types[1]), types };
+	}
+	if (quick.handler != nullptr) {
+		return quick.handler(m_env.heap(), lhv, rhv);
+	}
 
-			default: break;
-		}
+	if (!operators::is_suitable_for(expr.op.type, lhv.type(), rhv.type())) {
+		return error_no_suitable(expr.op, lhv, rhv);
+	}
 
-		return evaluation_result{ tl::make_unexpected(
-			std::format("Unknown operation '{}' ({})", token_string(op), token_name(op))
-		) };
-	}()
-		.or_else(std::move(throw_error))
-		.value_or(null_literal)
-	;
+	if (const auto result{ operators::binary(m_env.heap(), expr.op.type, lhv, rhv) }; result.has_value()) {
+		return result.value();
+	} else {
+		return error(error_code::ee_runtime_error, result.error(), expr.op);
+	}
 }
 
-auto interpreter::accept(const expression_grouping &group) -> literal {
+auto interpreter::accept(const expression_grouping &group) -> value {
 	if (!std::empty(group.expr)) {
 		return evaluate(group.expr);
-	} else {
-		error(error_code::ee_missing_expression, "");
 	}
+
+	return error(error_code::ee_missing_expression, "");
 }
 
-auto interpreter::accept(const expression_literal &value) -> literal {
-	return value.value;
+auto interpreter::accept(const expression_literal &lit) -> value {
+	/// The literals were converted once by the constructor. The record index is the index of its value
+	const auto &literals{ prog.get().get_expressions<expression_type::literal>() };
+	return m_literals[static_cast<size_t>(&lit - std::data(literals))];
 }
 
-auto interpreter::accept(const expression_logical &logic) -> literal {
+auto interpreter::accept(const expression_logical &logic) -> value {
 	const auto result{ evaluate(logic.left) };
-	const auto truth{ is_truth(result) };
+	const auto truth{ operators::is_truth(result) };
 	if (!truth.has_value()) {
 		error(lox::error_code::ee_condition_is_not_logical,
 			"Non-logical expression couldn't be used", logic.op
 		);
-		return null_literal;
+		return value::null();
 	}
 
 	switch (logic.op.type) {
 		case token_type::kw_or:
-			if (truth.value()) return null_literal;
+			if (truth.value()) return value::null();
 			break;
 
 		case token_type::kw_and:
-			if (!truth.value()) return null_literal;
+			if (!truth.value()) return value::null();
 			break;
 
 		default:
 			/// @todo error message
 			// error(lox::error_code::ee_)
-			return null_literal;
+			return value::null();
 	}
 
 	return evaluate(logic.right);
 }
 
-auto interpreter::accept(const expression_identifier &id) -> literal {
-	if (m_env.contains(id.name.lexeme_id, execution::search_range::globally)) {
-		return m_env.look_up(id.name.lexeme_id);
+auto interpreter::accept(const expression_identifier &id) -> value {
+	if (const auto found{ m_env.look_up(id.name.lexeme_id, id.target) }; found != nullptr) {
+		return *found;
 	}
 
-	error(error_code::ee_undefined_identifier, std::format(
+	return error(error_code::ee_undefined_identifier, std::format(
 		R"(Undefined identifier "{}")", lexemes.get().get(id.name.lexeme_id)
 	), id.name);
-	return null_literal;
 }
 
 #pragma endregion expression::visitor_interface methods
 
 #pragma region statement::visitor_interface methods
 
-void interpreter::accept(const statement_scope &scope) {
-	execute_block(scope.statements);
+auto interpreter::accept(const statement_scope &scope) -> completion {
+	return execute_block(prog.get().get(scope.statements));
 }
 
-void interpreter::accept(const statement_expression &expr) {
+auto interpreter::accept(const statement_expression &expr) -> completion {
 	if (!std::empty(expr.expr)) {
-		evaluate(expr.expr);
+		std::ignore = evaluate(expr.expr);
 	} else {
 		error(error_code::ee_missing_expression, "");
 	}
+	return completion::normal;
 }
 
-void interpreter::accept(const statement_function &func) {
-	m_env.register_function(func.name.lexeme_id, function{ [this, func](void *, std::span<const literal> args) {
-		for (size_t i{}; i < std::size(args); ++i) {
-			m_env.define_variable(func.params[i].lexeme_id, args[i]);
-		}
-
-		try {
-			execute(func.body);
-		} catch (literal output) {
-			return output;
-		}
+auto interpreter::accept(const statement_function &func) -> completion {
+	/// The record index is the index of the declaration
+	const auto &declarations{ prog.get().get_statements<statement_type::function>() };
+	const auto declaration{ static_cast<size_t>(&func - std::data(declarations)) };
 
-		return null_literal;
-	}, std::size(func.params) });
+	std::ignore = m_env.register_function(func.name.lexeme_id,
+		function::declared(declaration, std::size(func.params)), func.target
+	);
+	return completion::normal;
 }
 
-void interpreter::accept(const statement_branch &branch) {
-	if (auto truth{ is_truth(evaluate(branch.condition)) }; truth.has_value()) {
-		if (truth.value()) {
-			if (!std::empty(branch.then_branch)) execute(branch.then_branch);
-		} else {
-			if (!std::empty(branch.else_branch)) execute(branch.else_branch);
-		}
-	} else {
-		error(lox::error_code::ee_condition_is_not_logical,
-			"The condition of branch couldn't be converted to boolean type!"
-		);
+auto interpreter::accept(const statement_branch &branch) -> completion {
+	if (auto truth{ operators::is_truth(evaluate(branch.condition)) }; truth.has_value()) {
+		return execute(truth.value() ? branch.then_branch : branch.else_branch);
 	}
+
+	error(lox::error_code::ee_condition_is_not_logical,
+		"The condition of branch couldn't be converted to boolean type!"
+	);
+	return completion::normal;
 }
 
-void interpreter::accept(const statement_variable &var) {
-	if (m_env.contains(var.identifier.lexeme_id)) {
+auto interpreter::accept(const statement_variable &var) -> completion {
+	if (m_env.contains(var.identifier.lexeme_id, var.target)) {
 		error(error_code::ee_identifier_already_exists, std::format(
 			R"(Variable "{}" is already defined)", lexemes.get().get(var.identifier.lexeme_id)
 		), var.identifier);
 	}
 	std::ignore = m_env.define_variable(var.identifier.lexeme_id,
-		!std::empty(var.initializer) ? evaluate(var.initializer) : null_literal
+		!std::empty(var.initializer) ? evaluate(var.initializer) : value::null(), var.target
 	);
+	return completion::normal;
 }
 
-void interpreter::accept(const statement_constant &con) {
-	if (m_env.contains(con.identifier.lexeme_id)) {
+auto interpreter::accept(const statement_constant &con) -> completion {
+	if (m_env.contains(con.identifier.lexeme_id, con.target)) {
 		error(error_code::ee_identifier_already_exists, std::format(
 			R"(Constant "{}" is already defined)", lexemes.get().get(con.identifier.lexeme_id)
 		), con.identifier);
@@ -429,11 +331,12 @@ void interpreter::accept(const statement_constant &con) {
 		), con.identifier);
 	}
 
-	std::ignore = m_env.define_constant(con.identifier.lexeme_id, evaluate(con.initializer));
+	std::ignore = m_env.define_constant(con.identifier.lexeme_id, evaluate(con.initializer), con.target);
+	return completion::normal;
 }
 
-void interpreter::accept(const statement_loop &loop) {
-	const auto make_condition{ [this, &loop] { return is_truth(evaluate(loop.condition)); }};
+auto interpreter::accept(const statement_loop &loop) -> completion {
+	const auto make_condition{ [this, &loop] { return operators::is_truth(evaluate(loop.condition)); }};
 
 	auto cond{ make_condition() };
 	if (std::empty(loop.body)) {
@@ -442,7 +345,9 @@ void interpreter::accept(const statement_loop &loop) {
 		}
 	} else {
 		for (; cond.value_or(false); cond = make_condition()) {
-			execute(loop.body);
+			if (const auto result{ execute(loop.body) }; result != completion::normal) {
+				return result;
+			}
 		}
 	}
 
@@ -450,24 +355,54 @@ void interpreter::accept(const statement_loop &loop) {
 		error(lox::error_code::ee_condition_is_not_logical,
 			"The condition of 'while' loop couldn't be converted to boolean type!"
 		);
-		return;
 	}
+	return completion::normal;
+}
+
+auto interpreter::accept(const statement_ret &ret) -> completion {
+	m_result = evaluate(ret.value);
+	return completion::returning;
 }
 
 #pragma endregion statement::visitor_interface methods
 
-void interpreter::execute_block(const program::statement_list &statements) {
+auto interpreter::invoke(const function &callee, std::span<const value> args) -> value {
+	const auto &func{ prog.get().get_statements<statement_type::function>()[callee.declaration()] };
+	const auto params{ prog.get().get(func.params) };
+
+	/// The parameters are copied before the body runs: nested calls might grow the value stack
+	++m_frames_count;
 	m_env.push_scope();
-	try {
-		for (const auto &statement : statements) {
-			execute(statement);
-		}
-	} catch (...) {}
+	const auto distinct{ m_distinct_params[callee.declaration()] };
+	for (size_t i{}; i < std::size(args); ++i) {
+		const auto slot{ distinct
+			? coordinates{ .slot = static_cast<uint32_t>(i), .storage = coordinates::kind::local }
+			: coordinates{}
+		};
+		std::ignore = m_env.define_variable(params[i].lexeme_id, args[i], slot);
+	}
+
+	const auto result{ execute(func.body) == completion::returning
+		? std::exchange(m_result, value::null())
+		: value::null()
+	};
 	m_env.pop_scope();
+	--m_frames_count;
+	return result;
 }
 
-void interpreter::safe_assign(const token &tok, literal value) {
-	switch (m_env.assign(tok.lexeme_id, std::move(value))) {
+auto interpreter::execute_block(std::span<const statement_id> statements) -> completion {
+	m_env.push_scope();
+	auto result{ completion::normal };
+	for (const auto &statement : statements) {
+		if (result = execute(statement); result != completion::normal) break;
+	}
+	m_env.pop_scope();
+	return result;
+}
+
+void interpreter::safe_assign(const token &tok, coordinates target, value val) {
+	switch (m_env.assign(tok.lexeme_id, target, val)) {
 		using enum environment::assignment_status;
 
 		case not_found:
@@ -485,134 +420,26 @@ void interpreter::safe_assign(const token &tok, literal value) {
 		default: break;
 	}
 }
-auto interpreter::error_no_suitable(const token &op, const literal &value) const -> execution_error {
+auto interpreter::error_no_suitable(const token &op, value val) const -> value {
 	return error(error_code::ee_literal_not_suitable_for_operation,
-		std::format("Value '{}' is not suitable for '{}' ('{}') unary operation",
-			to_string(value), token_string(op.type), token_name(op.type)
-		), op
+		operators::make_no_suitable_error(op.type, val), op
 	);
 }
 
-auto interpreter::error_no_suitable(const token &op, const literal &lhv, const literal &rhv) const -> execution_error {
+auto interpreter::error_no_suitable(const token &op, value lhv, value rhv) const -> value {
 	return error(error_code::ee_literal_not_suitable_for_operation,
-		make_no_operator_error(op.type, lhv, rhv), op
+		operators::make_no_operator_error(op.type, lhv, rhv), op
 	);
 }
 
-auto interpreter::error(error_code err_no, std::string_view msg, const token &tok) const -> execution_error {
-	errout.get().report(msg, error_record{
-		.code = err_no,
-		.line = tok.line,
-		.from = tok.position,
-		.to   = static_cast<uint32_t>(std::size(token_string(tok.type)))
-	});
-	return execution_error{ std::data(msg) };
-}
-
-auto interpreter::error(error_code err_no, std::string_view msg) const -> execution_error {
-	errout.get().report(msg, error_record{
-		.code = err_no
-	});
-	return execution_error{ std::data(msg) };
-}
-
-auto interpreter::is_suitable_for(token_type op, literal_type type) -> bool {
-	/* THIS IS FOR UNARY OPERATIONS */
-
-	using enum literal_type;
-	switch (op) {
-		case token_type::plus: [[fallthrough]];
-		case token_type::minus: [[fallthrough]];
-		case token_type::slash: [[fallthrough]];
-		case token_type::star:
-			return utils::ct::any_from<number, integral>(type);
-
-		case token_type::increment: [[fallthrough]];
-		case token_type::decrement:
-			return type == integral;
-
-		case token_type::bang: [[fallthrough]];
-		case token_type::bang_equal: [[fallthrough]];
-		case token_type::equal_equal:
-			return true;
-
-		default: break;
-	}
-
-	return false;
-}
-
-auto interpreter::is_suitable_for(token_type op, literal_type lhv, literal_type rhv) -> bool {
-	/* THIS IS FOR BINARY OPERATIONS */
-	using enum literal_type;
-
-	const auto both_numbers{
-		utils::ct::any_from<number, integral>(lhv) &&
-		utils::ct::any_from<number, integral>(rhv)
-	};
-
-	switch (op) {
-		case token_type::minus: [[fallthrough]];
-		case token_type::slash: [[fallthrough]];
-		case token_type::star:
-			return both_numbers;
-
-		case token_type::plus:
-			return both_numbers || (lhv == literal_type::string && rhv == lhv);
-
-		case token_type::bang: [[fallthrough]];
-		case token_type::bang_equal: [[fallthrough]];
-		case token_type::equal_equal: [[fallthrough]];
-		case token_type::less: [[fallthrough]];
-		case token_type::less_equal: [[fallthrough]];
-		case token_type::greater: [[fallthrough]];
-		case token_type::greater_equal:
-			return lhv == rhv || both_numbers;
-
-		default: break;
-	}
-
-	return false;
-}
-
-auto interpreter::is_truth(const literal &value) -> std::optional<bool> {
-	if (value.is(literal_type::null)) {
-		return false;
-	}
-	if (auto boolean{ value.as<bool>() }; boolean) {
-		return *boolean;
-	}
-	if (auto real_number{ value.as<double>() }; real_number) {
-		return std::abs(*real_number) > std::numeric_limits<double>::epsilon();
-	}
-	if (auto integer{ value.as<int64_t>() }; integer) {
-		return *integer != 0ll;
-	}
-	if (auto str{ value.as<std::string>() }; str) {
-		return !std::empty(*str);
-	}
-	return std::nullopt;
-}
-
-auto interpreter::negate_number(literal &value) -> bool {
-	if (auto real_number{ value.as<double>() }; real_number) {
-		*real_number = -*real_number;
-		return true;
-	}
-	if (auto integer{ value.as<int64_t>() }; integer) {
-		*integer = -*integer;
-		return true;
-	}
-	return false;
+auto interpreter::error(error_code err_no, std::string_view msg, const token &tok) const -> value {
+	if (!m_halted) report(errout, err_no, msg, tok);
+	return value::null();
 }
 
-auto interpreter::inverse_boolean(literal &value) -> bool {
-	if (auto res{ is_truth(value) }; res.has_value()) {
-		value = res.value();
-		return true;
-	}
-	return false;
+auto interpreter::error(error_code err_no, std::string_view msg) const -> value {
+	if (!m_halted) report(errout, err_no, msg);
+	return value::null();
 }
 
-
 } // namespace lox::execution
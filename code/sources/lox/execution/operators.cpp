@@ -0,0 +1,298 @@
+#include <array>
+#include <cmath>
+#include <utility>
+#include <limits>
+#include <format>
+#include <algorithm>
+#include <functional>
+
+#include "lox/execution/operators.hpp"
+#include "lox/utils/compile_time.hpp"
+
+namespace lox::execution {
+
+namespace {
+
+namespace traits {
+
+template<token_type Type>
+struct operation { using type = void; };
+
+template<> struct operation<token_type::plus>          { using type = std::plus<>;               };
+template<> struct operation<token_type::minus>         { using type = std::minus<>;              };
+template<> struct operation<token_type::star>          { using type = std::multiplies<>;         };
+template<> struct operation<token_type::slash>         { using type = std::divides<>;            };
+
+template<> struct operation<token_type::equal_equal>   { using type = std::equal_to<>;           };
+template<> struct operation<token_type::bang_equal>    { using type = std::not_equal_to<>;       };
+template<> struct operation<token_type::less>          { using type = std::less<>;               };
+template<> struct operation<token_type::less_equal>    { using type = std::less_equal<>;         };
+template<> struct operation<token_type::greater>       { using type = std::greater<>;            };
+template<> struct operation<token_type::greater_equal> { using type = std::greater_equal<>;      };
+
+} // namespace traits
+
+/// The result of the operation wrapped into a value: either a boolean, a number or an integer
+auto wrap(value_heap &, bool result) noexcept -> value { return value::boolean(result); }
+auto wrap(value_heap &, double result) noexcept -> value { return value::number(result); }
+auto wrap(value_heap &heap, int64_t result) -> value { return heap.integral(result); }
+
+template<literal_type Type>
+auto numeric_of(const value val) noexcept {
+	if constexpr (Type == literal_type::integral) {
+		return val.as_integral();
+	} else {
+		return val.as_number();
+	}
+}
+
+/// Mixed operands are computed as numbers, the same ones keep their type
+template<token_type Type, literal_type Lhv, literal_type Rhv>
+auto specialized(value_heap &heap, const value lhv, const value rhv) -> value {
+	using Operation = traits::operation<Type>::type;
+	if constexpr (Lhv == Rhv) {
+		return wrap(heap, Operation{}(numeric_of<Lhv>(lhv), numeric_of<Rhv>(rhv)));
+	} else {
+		return wrap(heap, Operation{}(
+			static_cast<double>(numeric_of<Lhv>(lhv)), static_cast<double>(numeric_of<Rhv>(rhv))
+		));
+	}
+}
+
+template<operators::binary_handler Handler>
+auto expected(value_heap &heap, const value lhv, const value rhv) -> evaluation_result {
+	return Handler(heap, lhv, rhv);
+}
+
+auto concatenate(value_heap &heap, const value lhv, const value rhv) -> evaluation_result {
+	return heap.concat(lhv, rhv);
+}
+
+template<token_type Type>
+auto compare_strings(value_heap &, const value lhv, const value rhv) -> evaluation_result {
+	const typename traits::operation<Type>::type oper{};
+	/// Interned strings share the representation when they are equal
+	if constexpr (Type == token_type::equal_equal || Type == token_type::bang_equal) {
+		if (lhv.is_interned() && rhv.is_interned()) {
+			return value::boolean(oper(lhv.raw(), rhv.raw()));
+		}
+	}
+	return value::boolean(oper(lhv.as_string(), rhv.as_string()));
+}
+
+template<token_type Type>
+auto no_operator(value_heap &, const value lhv, const value rhv) -> evaluation_result {
+	return tl::make_unexpected(operators::make_no_operator_error(Type, lhv, rhv));
+}
+
+namespace dispatch {
+
+using kernel = auto (*)(value_heap &heap, value lhv, value rhv) -> evaluation_result;
+
+struct cell {
+	kernel eval;
+	operators::binary_handler handler; /// the same kernel without the checks, if any
+	bool suitable;                     /// the operand types are accepted by the operator
+};
+
+/// The rows of the table. A new operator needs a traits::operation specialization and a row
+constexpr std::array binary_operators{
+	token_type::plus, token_type::minus, token_type::star, token_type::slash,
+	token_type::equal_equal, token_type::bang_equal,
+	token_type::less, token_type::less_equal, token_type::greater, token_type::greater_equal,
+};
+
+constexpr size_t types_count{ static_cast<size_t>(literal_type::string) + 1ull };
+constexpr size_t row_size{ types_count * types_count };
+constexpr uint8_t no_row{ 0xFFu };
+
+[[nodiscard]] constexpr auto is_numeric(literal_type type) noexcept -> bool {
+	return type == literal_type::number || type == literal_type::integral;
+}
+
+template<token_type Type, literal_type Lhv, literal_type Rhv>
+consteval auto make_cell() noexcept -> cell {
+	if constexpr (is_numeric(Lhv) && is_numeric(Rhv)) {
+		constexpr operators::binary_handler handler{ &specialized<Type, Lhv, Rhv> };
+		return cell{ &expected<handler>, handler, true };
+	} else if constexpr (Lhv == literal_type::string && Rhv == literal_type::string) {
+		if constexpr (Type == token_type::plus) {
+			return cell{ &concatenate, nullptr, true };
+		} else if constexpr (token_traits::is_logical_v<Type>) {
+			return cell{ &compare_strings<Type>, nullptr, true };
+		}
+	}
+
+	/// The comparison of the same types is accepted, but only numbers and strings have the operator
+	return cell{ &no_operator<Type>, nullptr, token_traits::is_logical_v<Type> && Lhv == Rhv };
+}
+
+template<token_type Type, size_t ...Indices>
+consteval auto make_row(std::index_sequence<Indices...>) noexcept -> std::array<cell, row_size> {
+	return { make_cell<Type,
+		static_cast<literal_type>(Indices / types_count),
+		static_cast<literal_type>(Indices % types_count)
+	>()... };
+}
+
+template<size_t ...Rows>
+consteval auto make_table(std::index_sequence<Rows...>) noexcept {
+	return std::array{ make_row<binary_operators[Rows]>(std::make_index_sequence<row_size>{})... };
+}
+
+consteval auto make_rows_index() noexcept {
+	std::array<uint8_t, 0x100> rows{};
+	rows.fill(no_row);
+	for (size_t row{}; row < std::size(binary_operators); ++row) {
+		rows[static_cast<size_t>(binary_operators[row])] = static_cast<uint8_t>(row);
+	}
+	return rows;
+}
+
+constexpr auto table{ make_table(std::make_index_sequence<std::size(binary_operators)>{}) };
+constexpr auto rows_index{ make_rows_index() };
+
+/** @return the cell of the operator and the operand types or nullptr if it isn't a binary operator */
+[[nodiscard]] constexpr auto find(token_type op, literal_type lhv, literal_type rhv) noexcept -> const cell * {
+	const auto op_index{ static_cast<size_t>(op) };
+	if (op_index >= std::size(rows_index) || rows_index[op_index] == no_row) return nullptr;
+
+	return &table[rows_index[op_index]][static_cast<size_t>(lhv) * types_count + static_cast<size_t>(rhv)];
+}
+
+} // namespace dispatch
+
+auto negated_number(value_heap &, const value val) -> value { return value::number(-val.as_number()); }
+auto negated_integral(value_heap &heap, const value val) -> value { return heap.integral(-val.as_integral()); }
+
+} // namespace
+
+namespace operators {
+
+auto binary(value_heap &heap, token_type op, value lhv, value rhv) -> evaluation_result {
+	if (const auto cell{ dispatch::find(op, lhv.type(), rhv.type()) }; cell != nullptr) {
+		return cell->eval(heap, lhv, rhv);
+	}
+	return tl::make_unexpected(make_unknown_operation_error(op));
+}
+
+auto is_suitable_for(token_type op, literal_type type) noexcept -> bool {
+	/* THIS IS FOR UNARY OPERATIONS */
+
+	using enum literal_type;
+	switch (op) {
+		case token_type::plus: [[fallthrough]];
+		case token_type::minus: [[fallthrough]];
+		case token_type::slash: [[fallthrough]];
+		case token_type::star:
+			return utils::ct::any_from<number, integral>(type);
+
+		case token_type::increment: [[fallthrough]];
+		case token_type::decrement:
+			return type == integral;
+
+		case token_type::bang: [[fallthrough]];
+		case token_type::bang_equal: [[fallthrough]];
+		case token_type::equal_equal:
+			return true;
+
+		default: break;
+	}
+
+	return false;
+}
+
+auto is_suitable_for(token_type op, literal_type lhv, literal_type rhv) noexcept -> bool {
+	/* THIS IS FOR BINARY OPERATIONS */
+	const auto cell{ dispatch::find(op, lhv, rhv) };
+	return cell != nullptr && cell->suitable;
+}
+
+auto specialize(token_type op, literal_type lhv, literal_type rhv) noexcept -> binary_handler {
+	const auto cell{ dispatch::find(op, lhv, rhv) };
+	return cell != nullptr ? cell->handler : nullptr;
+}
+
+auto specialize(token_type op, literal_type type) noexcept -> unary_handler {
+	if (op != token_type::minus) return nullptr;
+
+	switch (type) {
+		case literal_type::number:   return &negated_number;
+		case literal_type::integral: return &negated_integral;
+
+		default: break;
+	}
+	return nullptr;
+}
+
+auto is_truth(value val) noexcept -> std::optional<bool> {
+	switch (val.type()) {
+		using enum literal_type;
+
+		case null:     return false;
+		case boolean:  return val.as_boolean();
+		case number:   return std::abs(val.as_number()) > std::numeric_limits<double>::epsilon();
+		case integral: return val.as_integral() != 0ll;
+		case string:   return !std::empty(val.as_string());
+
+		default: break;
+	}
+	return std::nullopt;
+}
+
+auto negate_number(value_heap &heap, value &val) -> bool {
+	if (val.is(literal_type::number)) {
+		val = value::number(-val.as_number());
+		return true;
+	}
+	if (val.is(literal_type::integral)) {
+		val = heap.integral(-val.as_integral());
+		return true;
+	}
+	return false;
+}
+
+auto inverse_boolean(value &val) noexcept -> bool {
+	if (auto res{ is_truth(val) }; res.has_value()) {
+		val = value::boolean(res.value());
+		return true;
+	}
+	return false;
+}
+
+auto make_no_operator_error(token_type op, value lhv, value rhv) -> std::string {
+	return std::format("No operator '{0}' for literals with types: '{1}' and '{2}':\n\t{3} {0} {4}",
+		token_string(op),
+		type_name(lhv.type()), type_name(rhv.type()),
+		to_string(lhv), to_string(rhv)
+	);
+}
+
+auto make_no_suitable_error(token_type op, value val) -> std::string {
+	return std::format("Value '{}' is not suitable for '{}' ('{}') unary operation",
+		to_string(val), token_string(op), token_name(op)
+	);
+}
+
+auto make_unknown_operation_error(token_type op) -> std::string {
+	return std::format("Unknown operation '{}' ({})", token_string(op), token_name(op));
+}
+
+} // namespace operators
+
+void report(error_handler &handler, error_code err_no, std::string_view msg, const token &tok) {
+	handler.report(msg, error_record{
+		.code = err_no,
+		.line = tok.line,
+		.from = tok.position,
+		.to   = static_cast<uint32_t>(std::size(token_string(tok.type)))
+	});
+}
+
+void report(error_handler &handler, error_code err_no, std::string_view msg) {
+	handler.report(msg, error_record{
+		.code = err_no
+	});
+}
+
+} // namespace lox::execution
@@ -0,0 +1,298 @@
+#include <span>
+
+#include "lox/execution/resolver.hpp"
+
+namespace lox::execution {
+
+resolver::resolver(program &prog, const environment &globals) : prog{ prog } {
+	globals.for_each_binding([this](lexeme_id name, const value &, bool) {
+		std::ignore = declare(name);
+	});
+}
+
+void resolver::resolve() {
+	collect_names();
+
+	/// The first walk only finds the calls. The globals it declares are forgotten after it
+	const auto globals{ m_scopes.front() };
+	m_stage = stage::collect;
+	for (const auto &stmt : prog.get()) {
+		resolve(stmt);
+	}
+	find_shadowed_names();
+
+	m_scopes.assign(1u, globals);
+	m_stage = stage::annotate;
+	for (const auto &stmt : prog.get()) {
+		resolve(stmt);
+	}
+}
+
+#pragma region expression::visitor_interface methods
+
+void resolver::accept(const expression_unary &unary) {
+	resolve(unary.expr);
+}
+
+void resolver::accept(const expression_incdec &incdec) {
+	if (m_stage == stage::annotate) {
+		prog.get().get_expressions<expression_type::incdec>(m_current).target = locate(incdec.name.lexeme_id);
+	}
+}
+
+void resolver::accept(const expression_assignment &assign) {
+	const auto self{ m_current };
+	resolve(assign.value);
+	if (m_stage == stage::annotate) {
+		prog.get().get_expressions<expression_type::assignment>(self).target = locate(assign.name.lexeme_id);
+	}
+}
+
+void resolver::accept(const expression_binary &binary) {
+	resolve(binary.left);
+	resolve(binary.right);
+}
+
+void resolver::accept(const expression_call &call) {
+	if (m_stage == stage::collect) {
+		record_call(call);
+	}
+
+	resolve(call.caller);
+	for (const auto arg : prog.get().get(call.args)) {
+		resolve(arg);
+	}
+}
+
+void resolver::accept(const expression_grouping &group) {
+	resolve(group.expr);
+}
+
+void resolver::accept(const expression_literal &) {}
+
+void resolver::accept(const expression_logical &logic) {
+	resolve(logic.left);
+	resolve(logic.right);
+}
+
+void resolver::accept(const expression_identifier &id) {
+	if (m_stage == stage::annotate) {
+		prog.get().get_expressions<expression_type::identifier>(m_current).target = locate(id.name.lexeme_id);
+	}
+}
+
+#pragma endregion expression::visitor_interface methods
+
+#pragma region statement::visitor_interface methods
+
+void resolver::accept(const statement_scope &scope) {
+	begin_scope();
+	for (const auto &statement : prog.get().get(scope.statements)) {
+		resolve(statement);
+	}
+	end_scope();
+}
+
+void resolver::accept(const statement_expression &expr) {
+	resolve(expr.expr);
+}
+
+void resolver::accept(const statement_function &func) {
+	if (const auto target{ declare(func.name.lexeme_id) }; m_stage == stage::annotate) {
+		record_of(func).target = target;
+	}
+
+	/// The call pushes the scope of the parameters, then the body pushes its own one
+	const auto &declarations{ prog.get().get_statements<statement_type::function>() };
+	const auto enclosing_function{ std::exchange(m_function, static_cast<size_t>(&func - std::data(declarations))) };
+	const auto enclosing_function_scope{ std::exchange(m_function_scope, std::size(m_scopes)) };
+	begin_scope();
+	for (const auto &param : prog.get().get(func.params)) {
+		std::ignore = declare(param.lexeme_id);
+	}
+	resolve(func.body);
+	end_scope();
+	m_function_scope = enclosing_function_scope;
+	m_function = enclosing_function;
+}
+
+void resolver::accept(const statement_branch &branch) {
+	resolve(branch.condition);
+	resolve(branch.then_branch);
+	resolve(branch.else_branch);
+}
+
+void resolver::accept(const statement_variable &var) {
+	resolve(var.initializer);
+	if (const auto target{ declare(var.identifier.lexeme_id) }; m_stage == stage::annotate) {
+		record_of(var).target = target;
+	}
+}
+
+void resolver::accept(const statement_constant &con) {
+	resolve(con.initializer);
+	if (const auto target{ declare(con.identifier.lexeme_id) }; m_stage == stage::annotate) {
+		record_of(con).target = target;
+	}
+}
+
+void resolver::accept(const statement_loop &loop) {
+	resolve(loop.condition);
+
+	const auto enclosing_repeated_scope{ std::exchange(m_repeated_scope, std::size(m_scopes)) };
+	resolve(loop.body);
+	m_repeated_scope = enclosing_repeated_scope;
+}
+
+void resolver::accept(const statement_ret &ret) {
+	resolve(ret.value);
+}
+
+#pragma endregion statement::visitor_interface methods
+
+void resolver::resolve(statement_id stmt) {
+	if (std::empty(stmt)) return;
+	prog.get().accept(*this, stmt);
+}
+
+void resolver::resolve(expression_id expr) {
+	if (std::empty(expr)) return;
+	m_current = expr;
+	prog.get().accept(*this, expr);
+}
+
+void resolver::begin_scope() {
+	m_scopes.emplace_back();
+}
+
+void resolver::end_scope() {
+	m_scopes.pop_back();
+}
+
+auto resolver::declare(lexeme_id name) -> coordinates {
+	/// The environment keeps the first definition of the name inside of the scope
+	auto &current{ m_scopes.back() };
+	const auto [found, inserted]{ current.try_emplace(name, static_cast<uint32_t>(std::size(current))) };
+
+	/// The repeated definitions fail, so the environment has to find the first one
+	if (!inserted || std::size(m_scopes) == m_repeated_scope) {
+		return coordinates{};
+	}
+	return coordinates{
+		.slot    = found->second,
+		.storage = std::size(m_scopes) == 1ull ? coordinates::kind::global : coordinates::kind::local
+	};
+}
+
+auto resolver::locate(lexeme_id name) const noexcept -> coordinates {
+	for (size_t scope{ std::size(m_scopes) }; scope > m_function_scope; --scope) {
+		const auto &bindings{ m_scopes[scope - 1ull] };
+		if (const auto found{ bindings.find(name) }; found != std::end(bindings)) {
+			return coordinates{
+				.depth   = static_cast<uint32_t>(std::size(m_scopes) - scope),
+				.slot    = found->second,
+				.storage = coordinates::kind::local
+			};
+		}
+	}
+
+	/// A caller of the function might have its own binding with the same name
+	if (m_function != script && m_shadowed[m_function].contains(name)) {
+		return coordinates{};
+	}
+
+	const auto &globals{ m_scopes.front() };
+	if (const auto found{ globals.find(name) }; found != std::end(globals)) {
+		return coordinates{ .slot = found->second, .storage = coordinates::kind::global };
+	}
+
+	return coordinates{};
+}
+
+void resolver::collect_names() {
+	const auto &program{ prog.get() };
+	const auto &functions{ program.get_statements<statement_type::function>() };
+
+	m_value_names.clear();
+	m_functions_by_name.clear();
+	m_callers.assign(std::size(functions), callers_info{});
+	m_unknown_callee = callers_info{};
+
+	for (size_t i{}; i < std::size(functions); ++i) {
+		m_functions_by_name[functions[i].name.lexeme_id].emplace_back(i);
+		for (const auto &param : program.get(functions[i].params)) {
+			m_value_names.emplace(param.lexeme_id);
+		}
+	}
+	for (const auto &var : program.get_statements<statement_type::variable>()) {
+		m_value_names.emplace(var.identifier.lexeme_id);
+	}
+	for (const auto &con : program.get_statements<statement_type::constant>()) {
+		m_value_names.emplace(con.identifier.lexeme_id);
+	}
+}
+
+void resolver::record_call(const expression_call &call) {
+	auto *callers{ &m_unknown_callee };
+
+	/// A variable might keep any function, so only the function names are trusted
+	std::span<const size_t> targets{};
+	if (call.caller.type() == expression_type::identifier) {
+		const auto name{ prog.get().get_expressions<expression_type::identifier>(call.caller).name.lexeme_id };
+		if (!m_value_names.contains(name)) {
+			const auto found{ m_functions_by_name.find(name) };
+			if (found == std::end(m_functions_by_name)) return; /// a native one or none at all
+			targets = found->second;
+			callers = nullptr;
+		}
+	}
+
+	const auto record{ [this](callers_info &info) {
+		/// The bindings of the function making the call, the globals aside
+		for (size_t scope{ m_function_scope }; scope < std::size(m_scopes); ++scope) {
+			for (const auto &[name, _] : m_scopes[scope]) {
+				info.names.emplace(name);
+			}
+		}
+		if (m_function != script) {
+			info.from.emplace_back(m_function);
+		}
+	} };
+
+	if (callers != nullptr) {
+		record(*callers);
+	}
+	for (const auto target : targets) {
+		record(m_callers[target]);
+	}
+}
+
+void resolver::find_shadowed_names() {
+	m_shadowed.assign(std::size(m_callers), name_set{});
+	for (size_t i{}; i < std::size(m_callers); ++i) {
+		m_shadowed[i] = m_callers[i].names;
+		m_shadowed[i].insert(std::begin(m_unknown_callee.names), std::end(m_unknown_callee.names));
+	}
+
+	/// The names bound for the caller stay bound for the callee, so they pass down the calls
+	for (bool changed{ true }; changed;) {
+		changed = false;
+		const auto inherit{ [this, &changed](size_t callee, size_t caller) {
+			if (callee == caller) return;
+			for (const auto name : m_shadowed[caller]) {
+				changed = m_shadowed[callee].emplace(name).second || changed;
+			}
+		} };
+
+		for (size_t callee{}; callee < std::size(m_callers); ++callee) {
+			for (const auto caller : m_callers[callee].from) {
+				inherit(callee, caller);
+			}
+			for (const auto caller : m_unknown_callee.from) {
+				inherit(callee, caller);
+			}
+		}
+	}
+}
+
+} // namespace lox::execution
@@ -0,0 +1,536 @@
+#include <format>
+#include <functional>
+
+#include "lox/constants.hpp"
+#include "lox/execution/virtual_machine.hpp"
+#include "lox/execution/operators.hpp"
+
+namespace lox::execution {
+
+namespace {
+
+/// Both operands have the same numeric type: skip the generic operators::binary dispatch
+template<class Operation>
+auto fast_path(value_heap &heap, value &lhv, const value rhv) -> bool {
+	const Operation oper{};
+	const auto lhv_type{ lhv.type() };
+	if (lhv_type != rhv.type()) return false;
+
+	if (lhv_type == literal_type::integral) {
+		const auto result{ oper(lhv.as_integral(), rhv.as_integral()) };
+		if constexpr (std::is_same_v<std::remove_cv_t<decltype(result)>, bool>) {
+			lhv = value::boolean(result);
+		} else {
+			lhv = heap.integral(result);
+		}
+		return true;
+	}
+	if (lhv_type == literal_type::number) {
+		const auto result{ oper(lhv.as_number(), rhv.as_number()) };
+		if constexpr (std::is_same_v<std::remove_cv_t<decltype(result)>, bool>) {
+			lhv = value::boolean(result);
+		} else {
+			lhv = value::number(result);
+		}
+		return true;
+	}
+	return false;
+}
+
+} // namespace
+
+virtual_machine::virtual_machine(
+	environment env,
+	const bytecode::module &mod,
+	const lexeme_database &lexemes,
+	error_handler &handler
+) : mod{ mod }, lexemes{ lexemes }, errout{ handler }, m_heap{ std::move(env.heap()) } {
+	/// The objects of the heap keep their addresses, so the values of env stay valid
+	m_constants.reserve(std::size(mod.constants));
+	for (const auto &constant : mod.constants) {
+		m_constants.emplace_back(m_heap.make(constant));
+	}
+
+	m_natives_count = env.functions_count();
+	m_callables.reserve(m_natives_count + std::size(mod.functions));
+	for (size_t i{}; i < m_natives_count; ++i) {
+		m_callables.emplace_back(std::in_place_type<function>, *env.function_at(i));
+	}
+	for (size_t i{ bytecode::module::script_id + 1ull }; i < std::size(mod.functions); ++i) {
+		m_callables.emplace_back(std::in_place_type<size_t>, i);
+	}
+
+	env.for_each_binding([this](lexeme_id name, value val, bool constant) {
+		global_at(name) = global{ val, true, constant };
+	});
+}
+
+auto virtual_machine::run() -> status {
+	m_stack.clear();
+	m_frames.clear();
+	m_bindings.clear();
+	m_stack.reserve(constants::initial_value_stack_size);
+	m_frames.reserve(constants::max_call_stack_depth);
+
+	const auto &script{ mod.get().script() };
+	m_stack.emplace_back(value::null()); /// the script acts as a callee without arguments
+	m_frames.emplace_back(&script, std::data(script.code), std::size(m_stack), 0ull);
+
+	return execute();
+}
+
+auto virtual_machine::execute() -> status {
+	using bytecode::read;
+	using bytecode::opcode;
+
+	const auto &constants{ m_constants };
+	auto &stack{ m_stack };
+
+	auto *current{ &m_frames.back() };
+	auto ip{ current->ip };
+
+	for (;;) {
+		switch (static_cast<opcode>(*ip++)) {
+			case opcode::constant:
+				stack.emplace_back(constants[read<uint32_t>(ip)]);
+				break;
+
+			case opcode::null:
+				stack.emplace_back(value::null());
+				break;
+
+			case opcode::pop:
+				stack.pop_back();
+				break;
+
+			case opcode::pop_locals: {
+				const auto count{ read<uint16_t>(ip) };
+				stack.resize(std::size(stack) - count);
+				m_bindings.resize(std::size(m_bindings) - count);
+			} break;
+
+			case opcode::get_local: {
+				const auto val{ stack[current->base + read<uint16_t>(ip)] };
+				stack.emplace_back(val);
+			} break;
+
+			case opcode::set_local:
+				stack[current->base + read<uint16_t>(ip)] = stack.back();
+				break;
+
+			case opcode::get_global: {
+				const auto name{ read<uint32_t>(ip) };
+				stack.emplace_back(get_global(name, read<uint32_t>(ip)));
+			} break;
+
+			case opcode::set_global: {
+				const auto name{ read<uint32_t>(ip) };
+				set_global(name, read<uint32_t>(ip), stack.back());
+			} break;
+
+			case opcode::get_dynamic: {
+				const auto name{ read<uint32_t>(ip) };
+				stack.emplace_back(get_dynamic(name, read<uint32_t>(ip)));
+			} break;
+
+			case opcode::set_dynamic: {
+				const auto name{ read<uint32_t>(ip) };
+				set_dynamic(name, read<uint32_t>(ip), stack.back());
+			} break;
+
+			case opcode::declare_global: {
+				const auto name{ read<uint32_t>(ip) };
+				const auto tok{ read<uint32_t>(ip) };
+				const auto is_constant{ read<uint8_t>(ip) != 0u };
+				if (global_at(name).defined) {
+					error(error_code::ee_identifier_already_exists, std::format(R"({} "{}" is already defined)",
+						(is_constant ? "Constant" : "Variable"), lexemes.get().get(name)
+					), tok);
+				}
+			} break;
+
+			case opcode::define_global: {
+				const auto name{ read<uint32_t>(ip) };
+				const auto is_constant{ read<uint8_t>(ip) != 0u };
+				/// The first definition wins just like environment::define_variable does
+				if (auto &var{ global_at(name) }; !var.defined) {
+					var = global{ stack.back(), true, is_constant };
+				}
+				stack.pop_back();
+			} break;
+
+			case opcode::define_local: {
+				const auto name{ read<uint32_t>(ip) };
+				const auto is_constant{ read<uint8_t>(ip) != 0u };
+				m_bindings.emplace_back(name, std::size(stack) - 1ull, is_constant);
+			} break;
+
+			case opcode::incdec_local: {
+				auto &val{ stack[current->base + read<uint16_t>(ip)] };
+				const auto tok{ read<uint32_t>(ip) };
+				const auto op{ read<uint32_t>(ip) };
+				const auto is_constant{ read<uint8_t>(ip) != 0u };
+				const auto result{ incdec(val, is_constant, tok, op) };
+				stack.emplace_back(result);
+			} break;
+
+			case opcode::incdec_global: {
+				const auto name{ read<uint32_t>(ip) };
+				const auto tok{ read<uint32_t>(ip) };
+				stack.emplace_back(incdec(name, nullptr, tok, read<uint32_t>(ip)));
+			} break;
+
+			case opcode::incdec_dynamic: {
+				const auto name{ read<uint32_t>(ip) };
+				const auto tok{ read<uint32_t>(ip) };
+				stack.emplace_back(incdec(name, find_dynamic(name), tok, read<uint32_t>(ip)));
+			} break;
+
+			case opcode::add:           arithmetic<std::plus<>>(token_type::plus, read<uint32_t>(ip)); break;
+			case opcode::subtract:      arithmetic<std::minus<>>(token_type::minus, read<uint32_t>(ip)); break;
+			case opcode::multiply:      arithmetic<std::multiplies<>>(token_type::star, read<uint32_t>(ip)); break;
+			case opcode::divide:        arithmetic<std::divides<>>(token_type::slash, read<uint32_t>(ip)); break;
+			case opcode::equal:         arithmetic<std::equal_to<>>(token_type::equal_equal, read<uint32_t>(ip)); break;
+			case opcode::not_equal:     arithmetic<std::not_equal_to<>>(token_type::bang_equal, read<uint32_t>(ip)); break;
+			case opcode::less:          arithmetic<std::less<>>(token_type::less, read<uint32_t>(ip)); break;
+			case opcode::less_equal:    arithmetic<std::less_equal<>>(token_type::less_equal, read<uint32_t>(ip)); break;
+			case opcode::greater:       arithmetic<std::greater<>>(token_type::greater, read<uint32_t>(ip)); break;
+			case opcode::greater_equal: arithmetic<std::greater_equal<>>(token_type::greater_equal, read<uint32_t>(ip)); break;
+
+			case opcode::binary: {
+				const auto tok{ read<uint32_t>(ip) };
+				const auto rhv{ stack.back() };
+				stack.pop_back();
+				stack.back() = binary(token_at(tok).type, stack.back(), rhv, tok);
+			} break;
+
+			case opcode::unary: {
+				const auto tok{ read<uint32_t>(ip) };
+				stack.back() = unary(stack.back(), tok);
+			} break;
+
+			case opcode::jump: {
+				const auto offset{ read<uint32_t>(ip) };
+				ip += offset;
+			} break;
+
+			case opcode::jump_if_false: {
+				const auto offset{ read<uint32_t>(ip) };
+				if (!operators::is_truth(stack.back()).value_or(false)) {
+					ip += offset;
+				}
+				stack.pop_back();
+			} break;
+
+			case opcode::loop: {
+				const auto offset{ read<uint32_t>(ip) };
+				ip -= offset;
+			} break;
+
+			case opcode::logical_and: {
+				const auto offset{ read<uint32_t>(ip) };
+				if (!operators::is_truth(stack.back()).value_or(false)) {
+					stack.back() = value::null();
+					ip += offset;
+				} else {
+					stack.pop_back();
+				}
+			} break;
+
+			case opcode::logical_or: {
+				const auto offset{ read<uint32_t>(ip) };
+				if (operators::is_truth(stack.back()).value_or(true)) {
+					stack.back() = value::null();
+					ip += offset;
+				} else {
+					stack.pop_back();
+				}
+			} break;
+
+			case opcode::check_call: {
+				const auto count{ read<uint16_t>(ip) };
+				const auto tok{ read<uint32_t>(ip) };
+				const auto offset{ read<uint32_t>(ip) };
+				switch (check_call(stack.back(), count, tok)) {
+					case call_check::ok: break;
+					case call_check::skipped:
+						stack.back() = value::null();
+						ip += offset;
+						break;
+					case call_check::overflow:
+						return halt();
+				}
+			} break;
+
+			case opcode::call: {
+				const auto count{ read<uint16_t>(ip) };
+				current->ip = ip;
+				call(count);
+				current = &m_frames.back();
+				ip = current->ip;
+			} break;
+
+			case opcode::function: {
+				const auto prototype{ read<uint32_t>(ip) };
+				stack.emplace_back(value::integral(static_cast<int64_t>(m_natives_count + prototype - 1ull)));
+			} break;
+
+			case opcode::ret: {
+				const auto result{ stack.back() };
+				if (std::size(m_frames) == 1ull) {
+					stack.clear();
+					m_bindings.clear();
+					m_frames.clear();
+					return status::ok;
+				}
+
+				m_bindings.resize(current->bindings_base);
+				stack.resize(current->base);
+				stack.back() = result;
+
+				m_frames.pop_back();
+				current = &m_frames.back();
+				ip = current->ip;
+			} break;
+
+			case opcode::report: {
+				const auto err_no{ static_cast<error_code>(read<uint32_t>(ip)) };
+				const auto &message{ mod.get().messages[read<uint32_t>(ip)] };
+				error(err_no, message, read<uint32_t>(ip));
+			} break;
+
+			default:
+				return status::invalid_program;
+		}
+	}
+}
+
+auto virtual_machine::global_at(lexeme_id name) -> global & {
+	if (name >= std::size(m_globals)) {
+		m_globals.resize(name + 1ull);
+	}
+	return m_globals[name];
+}
+
+auto virtual_machine::find_dynamic(lexeme_id name) noexcept -> binding * {
+	const auto end{ std::next(std::rbegin(m_bindings),
+		static_cast<std::ptrdiff_t>(std::size(m_bindings) - m_frames.back().bindings_base)
+	) };
+	const auto found{ std::find_if(end, std::rend(m_bindings), [name](const binding &b) {
+		return b.name == name;
+	}) };
+	return found != std::rend(m_bindings) ? &*found : nullptr;
+}
+
+auto virtual_machine::get_global(lexeme_id name, uint32_t tok) -> value {
+	if (const auto &var{ global_at(name) }; var.defined) {
+		return var.value;
+	}
+
+	if (tok != bytecode::no_token) {
+		error(error_code::ee_undefined_identifier, std::format(
+			R"(Undefined identifier "{}")", lexemes.get().get(name)
+		), tok);
+	}
+	return value::null();
+}
+
+auto virtual_machine::get_dynamic(lexeme_id name, uint32_t tok) -> value {
+	if (const auto found{ find_dynamic(name) }; found != nullptr) {
+		return m_stack[found->slot];
+	}
+	return get_global(name, tok);
+}
+
+void virtual_machine::set_global(lexeme_id name, uint32_t tok, value val) {
+	auto &var{ global_at(name) };
+	if (!var.defined) {
+		error(error_code::ee_undefined_identifier, std::format(
+			R"(Undefined variable "{}")", lexemes.get().get(name)
+		), tok);
+		return;
+	}
+	if (var.constant) {
+		error(error_code::ee_constant_assignment, std::format(
+			R"(Attempt to assign "{}" constant)", lexemes.get().get(name)
+		), tok);
+		return;
+	}
+	var.value = val;
+}
+
+void virtual_machine::set_dynamic(lexeme_id name, uint32_t tok, value val) {
+	const auto found{ find_dynamic(name) };
+	if (found == nullptr) {
+		set_global(name, tok, val);
+		return;
+	}
+	if (found->constant) {
+		error(error_code::ee_constant_assignment, std::format(
+			R"(Attempt to assign "{}" constant)", lexemes.get().get(name)
+		), tok);
+		return;
+	}
+	m_stack[found->slot] = val;
+}
+
+auto virtual_machine::incdec(value &val, bool constant, uint32_t tok, uint32_t op) -> value {
+	const auto type{ token_at(op).type };
+	if (!operators::is_suitable_for(type, val.type())) {
+		error(error_code::ee_literal_not_suitable_for_operation,
+			operators::make_no_suitable_error(type, val), op
+		);
+		return value::null();
+	}
+
+	const auto integer{ val.as_integral() };
+	const auto result{ m_heap.integral(type == token_type::increment ? integer + 1ll : integer - 1ll) };
+	if (constant) {
+		error(error_code::ee_constant_assignment, std::format(
+			R"(Attempt to assign "{}" constant)", lexemes.get().get(token_at(tok).lexeme_id)
+		), tok);
+	} else {
+		val = result;
+	}
+	return result;
+}
+
+auto virtual_machine::incdec(lexeme_id name, binding *local, uint32_t tok, uint32_t op) -> value {
+	if (local != nullptr) {
+		return incdec(m_stack[local->slot], local->constant, tok, op);
+	}
+
+	if (auto &var{ global_at(name) }; var.defined) {
+		return incdec(var.value, var.constant, tok, op);
+	}
+
+	error(error_code::ee_undefined_identifier, std::format(
+		R"(Undefined variable "{}")", lexemes.get().get(name)
+	), tok);
+	return value::null();
+}
+
+template<class Operation>
+void virtual_machine::arithmetic(token_type op, uint32_t tok) {
+	const auto rhv{ m_stack.back() };
+	m_stack.pop_back();
+
+	if (auto &lhv{ m_stack.back() }; !fast_path<Operation>(m_heap, lhv, rhv)) {
+		lhv = binary(op, lhv, rhv, tok);
+	}
+}
+
+auto virtual_machine::binary(token_type op, value lhv, value rhv, uint32_t tok) -> value {
+	if (!operators::is_suitable_for(op, lhv.type(), rhv.type())) {
+		error(error_code::ee_literal_not_suitable_for_operation,
+			operators::make_no_operator_error(op, lhv, rhv), tok
+		);
+		return value::null();
+	}
+
+	if (const auto result{ operators::binary(m_heap, op, lhv, rhv) }; result.has_value()) {
+		return result.value();
+	} else {
+		error(error_code::ee_runtime_error, result.error(), tok);
+	}
+	return value::null();
+}
+
+auto virtual_machine::unary(value val, uint32_t tok) -> value {
+	const auto op{ token_at(tok).type };
+	if (!operators::is_suitable_for(op, val.type())) {
+		error(error_code::ee_literal_not_suitable_for_operation,
+			operators::make_no_suitable_error(op, val), tok
+		);
+		return value::null();
+	}
+
+	switch (op) {
+		using enum token_type;
+
+		case minus: if (operators::negate_number(m_heap, val)) return val; break;
+		case bang:  if (operators::inverse_boolean(val)) return val; break;
+
+		default: break;
+	}
+
+	return value::null();
+}
+
+auto virtual_machine::check_call(const value &callee, uint16_t count, uint32_t tok) -> call_check {
+	if (!callee.is(literal_type::integral)) {
+		error(error_code::ee_invalid_callable, "Invalid callable expression", tok);
+		return call_check::skipped;
+	}
+
+	const auto id{ callee.as_integral() };
+	if (id < 0ll || static_cast<size_t>(id) >= std::size(m_callables)) {
+		error(error_code::ee_callable_not_found, "Cannot find function", tok);
+		return call_check::skipped;
+	}
+
+	const auto arity{ std::visit([this](const auto &target) -> std::optional<size_t> {
+		if constexpr (std::is_same_v<std::decay_t<decltype(target)>, function>) {
+			return target.arity();
+		} else {
+			return mod.get().functions[target].arity;
+		}
+	}, m_callables[id]) };
+
+	if (arity.has_value() && *arity != count) {
+		error(error_code::ee_invalid_arguments_cound,
+			std::format("Invalid count of arguments. Expected {}, but got {}", *arity, count),
+			tok
+		);
+		return call_check::skipped;
+	}
+
+	/// Native calls take no frame. The script frame counts, just like the interpreter does
+	if (static_cast<size_t>(id) >= m_natives_count && std::size(m_frames) >= constants::max_call_stack_depth) {
+		error(error_code::ee_stack_overflow, std::format(
+			"Stack overflow: more than {} calls in progress", constants::max_call_stack_depth - 1ull
+		), tok);
+		return call_check::overflow;
+	}
+
+	return call_check::ok;
+}
+
+void virtual_machine::call(uint16_t count) {
+	const auto base{ std::size(m_stack) - count };
+	auto &target{ m_callables[static_cast<size_t>(m_stack[base - 1ull].as_integral())] };
+
+	if (auto native{ std::get_if<function>(&target) }; native != nullptr) {
+		const auto result{ native->call(m_heap, std::span<const value>{ std::next(std::data(m_stack), base), count }) };
+		m_stack.resize(base);
+		m_stack.back() = result;
+		return;
+	}
+
+	const auto &prototype{ mod.get().functions[std::get<size_t>(target)] };
+	m_frames.emplace_back(&prototype, std::data(prototype.code), base, std::size(m_bindings));
+	for (size_t i{}; i < count; ++i) {
+		m_bindings.emplace_back(prototype.parameters[i], base + i, false);
+	}
+}
+
+auto virtual_machine::halt() -> status {
+	m_stack.clear();
+	m_bindings.clear();
+	m_frames.clear();
+	return status::runtime_error;
+}
+
+auto virtual_machine::token_at(uint32_t id) const noexcept -> const token & {
+	return mod.get().tokens[id];
+}
+
+void virtual_machine::error(error_code err_no, std::string_view msg, uint32_t tok) const {
+	if (tok == bytecode::no_token) {
+		report(errout, err_no, msg);
+	} else {
+		report(errout, err_no, msg, token_at(tok));
+	}
+}
+
+} // namespace lox::execution
@@ -0,0 +1,117 @@
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <shared_mutex>
+
+#include "lox/front_end.hpp"
+#include "lox/scanner.hpp"
+#include "lox/parser.hpp"
+
+namespace lox {
+
+namespace {
+
+struct shared_lexemes {
+	lexeme_database &lexemes;
+	std::shared_mutex mutex{};
+
+	/**
+	 * Most of the lexemes of a file are met in the other ones as well,
+	 * so they're found under the shared lock, and only the new ones wait
+	 * for the exclusive one.
+	 * @return the shared ids by the ids of the file
+	 */
+	auto intern(const lexeme_database &own) -> std::vector<uint32_t> {
+		std::vector<uint32_t> ids(std::size(own) + 1u, invalid_id);
+		std::vector<uint32_t> missing{};
+
+		{
+			std::shared_lock lock{ mutex };
+			for (uint32_t id{ 1u }; id < std::size(ids); ++id) {
+				if (const auto found{ lexemes.find(own.get(id)) }; found != lexeme_database::npos) {
+					ids[id] = static_cast<uint32_t>(found);
+				} else {
+					missing.emplace_back(id);
+				}
+			}
+		}
+
+		if (!std::empty(missing)) {
+			std::unique_lock lock{ mutex };
+			for (const auto id : missing) {
+				ids[id] = static_cast<uint32_t>(lexemes.add(own.get(id)));
+			}
+		}
+
+		return ids;
+	}
+};
+
+void process(source_unit &unit, shared_lexemes &shared) {
+	unit.ctx = scanner{ unit.file.view(), unit.scan_errors }.scan();
+
+	const auto ids{ shared.intern(unit.ctx.lexemes) };
+	token_buffer tokens{};
+	tokens.reserve(std::size(unit.ctx.tokens));
+	tokens.append(unit.ctx.tokens, 0u, 0u, [&ids](const token_type type, const uint32_t id) {
+		return type == token_type::identifier ? ids[id] : id;
+	});
+	unit.ctx.tokens = std::move(tokens);
+	unit.ctx.lexemes = lexeme_database{};
+
+	unit.parse_errors.set_line_index(unit.ctx.lines);
+	unit.prog = parser{ unit.ctx, unit.parse_errors }.parse();
+	unit.prog.relayout();
+}
+
+} // namespace
+
+source_unit::source_unit(source_file source) noexcept
+	: file{ std::move(source) }
+	, scan_errors{ file.path(), file.view() }
+	, parse_errors{ file.path(), file.view() }
+{}
+
+auto parse_files(std::span<const std::string> paths, size_t jobs) -> tl::expected<project, std::string> {
+	project output{};
+	if (std::empty(paths)) {
+		return output;
+	}
+
+	output.units.reserve(std::size(paths));
+	for (const auto &path : paths) {
+		auto file{ source_file::open(path) };
+		if (!file.has_value()) {
+			return tl::unexpected{ std::move(file.error()) };
+		}
+		output.units.emplace_back(std::make_unique<source_unit>(std::move(*file)));
+	}
+
+	if (jobs == 0u) {
+		jobs = std::thread::hardware_concurrency();
+	}
+	jobs = std::clamp(jobs, size_t{ 1u }, std::size(paths));
+
+	shared_lexemes shared{ output.lexemes };
+	std::atomic<size_t> next{};
+	const auto work{ [&] {
+		for (auto i{ next++ }; i < std::size(output.units); i = next++) {
+			process(*output.units[i], shared);
+		}
+	} };
+
+	std::vector<std::future<void>> workers;
+	workers.reserve(jobs);
+	for (size_t job{}; job < jobs; ++job) {
+		workers.emplace_back(std::async(std::launch::async, work));
+	}
+	for (auto &worker : workers) {
+		worker.get();
+	}
+
+	return output;
+}
+
+} // namespace lox
@@ -1,58 +1,174 @@
+#include <bit>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOX_LEXEMES_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "lox/lexeme_database.hpp"
 
 #include "lox/utils/strhash.hpp"
 
 namespace lox {
 
+namespace {
+
+constexpr uint8_t empty_tag{ 0x80 };
+
+/// The finalizer of MurmurHash3, fnv1a spreads the last bytes only to the high bits
+[[nodiscard]] auto hash_of(const std::string_view lexeme) noexcept -> uint64_t {
+	auto hash{ utils::fnv1a_64(lexeme) };
+	hash = (hash ^ (hash >> 33u)) * 0xFF51AFD7ED558CCD;
+	hash = (hash ^ (hash >> 33u)) * 0xC4CEB9FE1A85EC53;
+	return hash ^ (hash >> 33u);
+}
+
+[[nodiscard]] constexpr auto tag_of(const uint64_t hash) noexcept -> uint8_t {
+	return static_cast<uint8_t>(hash & 0x7Fu);
+}
+
+/** @return the bit mask of the tags of the group which are equal to the given one */
+[[nodiscard]] auto match(const uint8_t *tags, const uint8_t tag) noexcept -> uint32_t {
+#if defined(LOX_LEXEMES_SSE2)
+	const auto group{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(tags)) };
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+	uint32_t found{};
+	for (uint32_t i{}; i < 16u; ++i) {
+		found |= static_cast<uint32_t>(tags[i] == tag) << i;
+	}
+	return found;
+#endif
+}
+
+/** @return the bit mask of the empty slots of the group */
+[[nodiscard]] auto match_empty(const uint8_t *tags) noexcept -> uint32_t {
+#if defined(LOX_LEXEMES_SSE2)
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tags))));
+#else
+	uint32_t found{};
+	for (uint32_t i{}; i < 16u; ++i) {
+		found |= static_cast<uint32_t>(tags[i] >> 7u) << i;
+	}
+	return found;
+#endif
+}
+
+} // namespace
+
 auto lexeme_database::add(std::string_view lexeme) noexcept -> lexeme_id {
 	if (std::empty(lexeme)) {
 		return npos;
 	}
 
-	const auto hash{ utils::fnv1a(lexeme) };
-	if (const auto found{ find(hash) }; found != npos) {
-		return found;
+	if (std::empty(m_slots)) {
+		grow();
 	}
 
-	const auto [offset, length]{ m_sections.back() };
-	if (const auto required_size{ std::size(m_buffer) + std::size(lexeme) };
-		std::size(m_buffer) < required_size
-	) {
-		m_buffer.resize(required_size);
+	const auto hash{ hash_of(lexeme) };
+	auto [slot, found]{ locate(lexeme, hash) };
+	if (found != npos) {
+		return found;
 	}
 
-	const auto new_offset{ offset + length };
-	std::ranges::copy(lexeme, std::next(std::begin(m_buffer), new_offset));
+	/// The table is kept at most 7/8 full, so a probe always meets an empty slot
+	if (8u * std::size(m_lexemes) > 7u * std::size(m_slots)) {
+		grow();
+		slot = locate(lexeme, hash).slot;
+	}
 
-	const lexeme_id id{ std::size(m_sections) };
-	m_sections.emplace_back(new_offset, std::size(lexeme));
+	const lexeme_id id{ std::size(m_lexemes) };
+	m_lexemes.push_back(store(lexeme));
+	m_hashes.push_back(hash);
 
-	m_lookup_table.emplace(hash, id);
+	m_tags[slot]  = tag_of(hash);
+	m_slots[slot] = static_cast<uint32_t>(id);
 
 	return id;
 }
 
 auto lexeme_database::find(std::string_view lexeme) const noexcept -> lexeme_id {
-	if (!std::empty(lexeme)) {
-		return find(utils::fnv1a(lexeme));
+	if (!std::empty(lexeme) && !std::empty(m_slots)) {
+		return locate(lexeme, hash_of(lexeme)).id;
 	}
 	return npos;
 }
 
 auto lexeme_database::get(lexeme_id id) const noexcept -> std::string_view {
-	if (id < std::size(m_sections)) {
-		const auto [offset, length]{ m_sections.at(id) };
-		return std::string_view{ std::next(std::data(m_buffer), offset), length };
+	if (id < std::size(m_lexemes)) {
+		return m_lexemes[id];
 	}
-
 	return {};
 }
 
-auto lexeme_database::find(hash_type hash) const noexcept -> lexeme_id {
-	if (const auto found{ m_lookup_table.find(hash) }; found != std::end(m_lookup_table)) {
-		return found->second;
+/**
+ * The groups are probed by the triangular numbers, which visit
+ * every group once when the count of them is a power of two.
+ * @return the slot of the lexeme, or the first empty one with npos
+ */
+auto lexeme_database::locate(std::string_view lexeme, uint64_t hash) const noexcept -> lookup {
+	const auto tag{ tag_of(hash) };
+	const auto group_mask{ std::size(m_slots) / group_size - 1u };
+	auto group{ static_cast<size_t>(hash >> 7u) & group_mask };
+
+	for (size_t step{ 1u };; ++step) {
+		const auto base{ group * group_size };
+		const auto tags{ std::next(std::data(m_tags), base) };
+
+		for (auto found{ match(tags, tag) }; found != 0u; found &= found - 1u) {
+			const auto slot{ base + static_cast<size_t>(std::countr_zero(found)) };
+			if (const auto id{ m_slots[slot] }; m_lexemes[id] == lexeme) {
+				return lookup{ slot, id };
+			}
+		}
+
+		if (const auto empty{ match_empty(tags) }; empty != 0u) {
+			return lookup{ base + static_cast<size_t>(std::countr_zero(empty)), npos };
+		}
+
+		group = (group + step) & group_mask;
+	}
+}
+
+auto lexeme_database::store(std::string_view lexeme) -> std::string_view {
+	const auto length{ std::size(lexeme) };
+	if (std::empty(m_chunks) || m_chunk_capacity - m_chunk_used < length) {
+		/// The long lexemes get a chunk of their own
+		m_chunk_capacity = (std::max)(chunk_size, length);
+		m_chunk_used = 0u;
+		m_chunks.push_back(std::make_unique_for_overwrite<char[]>(m_chunk_capacity));
+	}
+
+	const auto data{ std::next(m_chunks.back().get(), static_cast<ptrdiff_t>(m_chunk_used)) };
+	std::memcpy(data, std::data(lexeme), length);
+	m_chunk_used += length;
+
+	return std::string_view{ data, length };
+}
+
+void lexeme_database::grow() {
+	const auto capacity{ std::empty(m_slots) ? group_size : 2u * std::size(m_slots) };
+	m_tags.assign(capacity, empty_tag);
+	m_slots.assign(capacity, 0u);
+
+	const auto group_mask{ capacity / group_size - 1u };
+	for (size_t id{ 1u }; id < std::size(m_lexemes); ++id) {
+		const auto hash{ m_hashes[id] };
+		auto group{ static_cast<size_t>(hash >> 7u) & group_mask };
+
+		for (size_t step{ 1u };; ++step) {
+			const auto base{ group * group_size };
+			if (const auto empty{ match_empty(std::next(std::data(m_tags), base)) }; empty != 0u) {
+				const auto slot{ base + static_cast<size_t>(std::countr_zero(empty)) };
+				m_tags[slot]  = tag_of(hash);
+				m_slots[slot] = static_cast<uint32_t>(id);
+				break;
+			}
+			group = (group + step) & group_mask;
+		}
 	}
-	return npos;
 }
 
 } // namespace lox
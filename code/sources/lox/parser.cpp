@@ -1,8 +1,11 @@
 #include <format>
+#include <future>
 #include <ranges>
+#include <thread>
 #include <algorithm>
 
 #include "lox/parser.hpp"
+#include "lox/scanner.hpp"
 #include "lox/constants.hpp"
 #include "lox/utils/vecutils.hpp"
 #include "lox/utils/compile_time.hpp"
@@ -14,6 +17,12 @@ parser::parser(const context &ctx, error_handler &errs) noexcept
 	, errout{ errs }
 {}
 
+parser::parser(scanner &stream, error_handler &errs) noexcept
+	: ctx{ stream.streamed() }
+	, errout{ errs }
+	, m_stream{ &stream }
+{}
+
 auto parser::parse() -> program {
 	program out{};
 
@@ -24,7 +33,102 @@ auto parser::parse() -> program {
 	return out;
 }
 
+auto parser::parse_parallel(size_t jobs) -> program {
+	if (jobs == 0u) {
+		jobs = std::thread::hardware_concurrency();
+	}
+	if (m_stream != nullptr) {
+		return parse();
+	}
+	jobs = (std::min)(jobs, std::size(ctx.tokens) / constants::parallel_parse_min_tokens);
+	if (jobs < 2u) {
+		return parse();
+	}
+
+	const auto bounds{ split_declarations(jobs) };
+	if (std::size(bounds) < 3u) {
+		return parse();
+	}
+
+	std::vector<std::future<std::optional<program>>> ranges;
+	ranges.reserve(std::size(bounds) - 1u);
+	for (size_t i{ 1u }; i < std::size(bounds); ++i) {
+		ranges.emplace_back(std::async(std::launch::async, &parser::parse_range, this, bounds[i - 1u], bounds[i]));
+	}
+
+	program out{};
+	bool failed{ false };
+	for (auto &range : ranges) {
+		if (auto part{ range.get() }; part.has_value() && !failed) {
+			out.append(std::move(*part));
+		} else {
+			failed = true;
+		}
+	}
+
+	if (failed) {
+		return parse();
+	}
+	return out;
+}
+
+/**
+ * A top level declaration ends with a semicolon or a closing brace outside of any brackets,
+ * unless the next token still belongs to it, like 'else' or the semicolon after the initializer.
+ * @return the bounds of the ranges, the first declaration after every 1/jobs of the tokens.
+ * It's empty when the brackets aren't balanced, then parse() reports them.
+ */
+auto parser::split_declarations(const size_t jobs) const -> std::vector<size_t> {
+	using enum token_type;
+
+	const auto count{ std::size(ctx.tokens) };
+	std::vector<size_t> bounds{ 0u };
+	int64_t depth{};
+
+	for (size_t i{}; i + 1u < count; ++i) {
+		const auto type{ ctx.tokens.type_at(i) };
+		if (type == left_paren || type == left_brace) {
+			++depth;
+			continue;
+		}
+		if (type == right_paren || type == right_brace) {
+			if (--depth < 0) return {};
+		}
+		if (depth != 0 || (type != semicolon && type != right_brace)) continue;
+
+		const auto next{ ctx.tokens.type_at(i + 1u) };
+		if (next == kw_else || next == semicolon || next == end_of_file) continue;
+
+		if (i + 1u >= count * std::size(bounds) / jobs) {
+			bounds.emplace_back(i + 1u);
+		}
+	}
+
+	if (depth != 0) return {};
+
+	bounds.emplace_back(count);
+	return bounds;
+}
+
+/** @return the program of the declarations, or nothing when they have errors */
+auto parser::parse_range(const size_t from, const size_t till) const -> std::optional<program> {
+	error_handler errors{ std::string{} };
+	parser worker{ ctx, errors };
+	worker.m_current = from;
+	worker.m_end = till;
+
+	auto out{ worker.parse() };
+	if (!std::empty(errors)) {
+		return std::nullopt;
+	}
+	return out;
+}
+
 auto parser::declaration(program &prog) -> statement_id {
+	const auto start{ m_current };
+	const auto statements_mark{ std::size(m_statements) };
+	const auto arguments_mark{ std::size(m_arguments) };
+	const auto parameters_mark{ std::size(m_parameters) };
 	try {
 		if (match<token_type::kw_fun>()) {
 			return function_declaration(prog, "function");
@@ -36,7 +140,14 @@ auto parser::declaration(program &prog) -> statement_id {
 
 		return stmt(prog);
 	} catch (const error &e) {
+		/// The token which broke the declaration has to be skipped, otherwise the parser sticks to it
+		if (m_current == start) advice();
 		synchronize();
+
+		/// The children of the broken nodes are dropped, the enclosing ones continue on the top of them
+		m_statements.resize(statements_mark);
+		m_arguments.resize(arguments_mark);
+		m_parameters.resize(parameters_mark);
 	}
 
 	return statement_id{};
@@ -49,27 +160,34 @@ auto parser::function_declaration(program &prog, std::string_view kind) -> state
 	const auto name{ consume(identifier, std::format("Expected {} name.", kind), peek()) };
 	consume(left_paren, std::format("Exprected '(' after {} name.", kind), peek());
 
-	std::vector<token> parameters{};
+	const auto mark{ std::size(m_parameters) };
 	if (!check(right_paren)) {
 		bool many_args_logged{ false };
 		do {
-			if (!many_args_logged && std::size(parameters) > constants::max_call_stack_depth) {
+			if (!many_args_logged && std::size(m_parameters) - mark > constants::max_call_stack_depth) {
 				make_error(std::format("Too many parameters for {}!", kind),
 					error_code::pe_too_many_arguments, peek()
 				);
 				many_args_logged = true;
 			}
 
-			parameters.emplace_back(consume(identifier, "Expect parameter name.", peek()));
+			m_parameters.emplace_back(consume(identifier, "Expect parameter name.", peek()));
 		} while (match<comma>());
 	}
 
 	consume(right_paren, std::format("Exprected ')' after {} parameters.", kind), peek(),
 		error_code::pe_broken_symmetry
 	);
+	/// Stored before the body, which might declare functions of its own
+	const auto parameters{ pool_children(prog, m_parameters, mark) };
 
 	consume(left_brace, std::format("Expected '{{' after {} declaration", kind), peek());
-	return prog.emplace<statement_type::function>(name, std::move(parameters), scope_stmt(prog));
+
+	++m_function_depth;
+	const auto body{ scope_stmt(prog) };
+	--m_function_depth;
+
+	return prog.emplace<statement_type::function>(name, parameters, body);
 }
 
 auto parser::storage_declaration(program &prog) -> statement_id {
@@ -112,7 +230,7 @@ auto parser::object_declaration(program &prog, std::string_view name) -> std::pa
 
 	expression_id expr_{};
 	if (!match<token_type::right_brace>()) {
-		const auto &init_start{ peek() };
+		const auto init_start{ peek() };
 		if (!match<token_type::right_brace>()) {
 			expr_ = expr(prog);
 			consume(token_type::right_brace,
@@ -126,7 +244,7 @@ auto parser::object_declaration(program &prog, std::string_view name) -> std::pa
 			);
 		}
 	} else {
-		expr_ = prog.emplace<expression_type::literal>(null_literal);
+		expr_ = prog.emplace<expression_type::literal>(prog.store(null_literal));
 	}
 
 	return std::make_pair(identifier, expr_);
@@ -146,6 +264,9 @@ auto parser::stmt(program &prog) -> statement_id {
 	if (match<token_type::left_brace>()) {
 		return scope_stmt(prog);
 	}
+	if (match<token_type::kw_return>()) {
+		return return_stmt(prog);
+	}
 
 	return make_stmt<statement_type::expression>(prog, &parser::expr);
 }
@@ -172,7 +293,8 @@ auto parser::branch_stmt(program &prog) -> statement_id {
 	) };
 
 	if (!std::empty(declaration)) {
-		return prog.emplace<statement_type::scope>(std::vector<statement_id>{ declaration, branch });
+		const std::array statements{ declaration, branch };
+		return prog.emplace<statement_type::scope>(prog.store(statements));
 	}
 
 	return branch;
@@ -202,7 +324,10 @@ auto parser::for_loop_stmt(program &prog) -> statement_id {
 	consume(left_paren, "Expected '(' after 'while' statement", peek());
 
 	auto declaration{ make_declaration_or_expression_stmt(prog) };
-	auto condition{ match<semicolon>() ? prog.emplace<expression_type::literal>(true) : expr(prog) };
+	auto condition{ match<semicolon>()
+		? prog.emplace<expression_type::literal>(prog.store(literal{ true }))
+		: expr(prog)
+	};
 	consume(semicolon, "Expected ';' after 'for' condition", peek(),
 		error_code::pe_missing_end_of_statement
 	);
@@ -212,32 +337,44 @@ auto parser::for_loop_stmt(program &prog) -> statement_id {
 
 	consume(left_brace, "'for' requires '{' block", peek());
 
-	auto body{ scope_stmt(prog) };
+	/// The pooled statements can't grow, so the increment is added before the scope is made
+	const auto mark{ block(prog) };
 	if (!std::empty(increment_expr)) {
-		prog.get_statements<statement_type::scope>(body).statements.emplace_back(
-			prog.emplace<statement_type::expression>(increment_expr)
-		);
+		const auto increment{ prog.emplace<statement_type::expression>(increment_expr) };
+		m_statements.emplace_back(increment);
 	}
+	const auto body{ prog.emplace<statement_type::scope>(pool_children(prog, m_statements, mark)) };
 	return make_loop(prog, declaration, condition, body);
 }
 
 auto parser::scope_stmt(program &prog) -> statement_id {
+	const auto mark{ block(prog) };
+	return prog.emplace<statement_type::scope>(pool_children(prog, m_statements, mark));
+}
+
+auto parser::block(program &prog) -> size_t {
 	using enum token_type;
 
-	std::vector<statement_id> statements{};
-	while (!at_end() && !utils::ct::any_from(right_brace, peek().type, previous().type)) {
-		statements.emplace_back(declaration(prog));
+	const auto mark{ std::size(m_statements) };
+	while (!at_end() && !check(right_brace)) {
+		const auto statement{ declaration(prog) };
+		m_statements.emplace_back(statement);
 	}
-	if (const auto &prev{ previous() }; prev.type == right_brace) {
-		make_error("It seems like there should be ';' before '}'",
-			error_code::pe_missing_end_of_statement, prev
-		);
-	} else {
-		consume(right_brace, "Expected '}' after block", peek(),
-			error_code::pe_broken_symmetry
-		);
+	consume(right_brace, "Expected '}' after block", peek(),
+		error_code::pe_broken_symmetry
+	);
+	return mark;
+}
+
+auto parser::return_stmt(program &prog) -> statement_id {
+	const auto keyword{ previous() };
+	if (m_function_depth == 0ull) {
+		make_error("Cannot return from the top-level code", error_code::pe_return_outside_function, keyword);
 	}
-	return prog.emplace<statement_type::scope>(std::move(statements));
+
+	const auto value{ check(token_type::semicolon) ? expression_id{} : expr(prog) };
+	consume_end_of_statement();
+	return prog.emplace<statement_type::ret>(keyword, value);
 }
 
 auto parser::make_declaration_or_expression_stmt(program &prog) -> statement_id {
@@ -259,7 +396,8 @@ auto parser::make_loop(program &prog,
 ) -> statement_id {
 	auto loop{ prog.emplace<statement_type::loop>(condition, body) };
 	if (!std::empty(declaration)) {
-		return prog.emplace<statement_type::scope>(std::vector<statement_id>{ declaration, loop });
+		const std::array statements{ declaration, loop };
+		return prog.emplace<statement_type::scope>(prog.store(statements));
 	}
 
 	return std::move(loop);
@@ -273,9 +411,9 @@ auto parser::incdec(program &prog) -> expression_id {
 	using enum token_type;
 
 	if (match<increment, decrement>()) {
-		const auto &op{ previous() };
+		const auto op{ previous() };
 		auto identifier{ logical_or(prog) };
-		if (identifier.type != expression_type::identifier) {
+		if (identifier.type() != expression_type::identifier) {
 			make_error(std::format("Invalid {} target.", token_name(op.type)),
 				lox::error_code::pe_lvalue_assignment, op
 			);
@@ -307,9 +445,9 @@ auto parser::assignment(program &prog) -> expression_id {
 
 
 	if (match<equal, plus_equal, minus_equal, star_equal, slash_equal>()) {
-		const auto &equals_token{ previous() };
+		const auto equals_token{ previous() };
 		auto value{ assignment(prog) };
-		if (expr_.type != expression_type::identifier) {
+		if (expr_.type() != expression_type::identifier) {
 			make_error("Invalid assignment target.", lox::error_code::pe_lvalue_assignment, equals_token);
 			return expr_;
 		}
@@ -362,7 +500,7 @@ auto parser::factor(program &prog) -> expression_id {
 
 auto parser::unary(program &prog) -> expression_id {
 	if (match<token_type::bang, token_type::minus>()) {
-		const auto &op{ previous() };
+		const auto op{ previous() };
 		return prog.emplace<expression_type::unary>(op, unary(prog));
 	}
 	return call(prog);
@@ -384,35 +522,36 @@ auto parser::call(program &prog) -> expression_id {
 }
 
 auto parser::call_finish(program &prog, expression_id caller) -> expression_id {
-	std::vector<expression_id> arguments{};
+	const auto mark{ std::size(m_arguments) };
 	if (!check(token_type::right_paren)) {
 		bool many_args_logged{ false };
 		do {
-			if (!many_args_logged && std::size(arguments) > constants::max_call_stack_depth) {
+			if (!many_args_logged && std::size(m_arguments) - mark > constants::max_call_stack_depth) {
 				make_error("Too many arguments for this call!",
 					error_code::pe_too_many_arguments, peek()
 				);
 				many_args_logged = true;
 			}
 
-			arguments.emplace_back(expr(prog));
+			const auto argument{ expr(prog) };
+			m_arguments.emplace_back(argument);
 		} while (match<token_type::comma>());
 	}
 
-	const auto &paren{ consume(token_type::right_paren,
+	const auto paren{ consume(token_type::right_paren,
 		"Expected ')' after arguments.", previous(), error_code::pe_broken_symmetry
 	) };
-	return prog.emplace<expression_type::call>(paren, caller, std::move(arguments));
+	return prog.emplace<expression_type::call>(paren, caller, pool_children(prog, m_arguments, mark));
 }
 
 auto parser::primary(program &prog) -> expression_id {
 	using enum token_type;
 
 	if (match<string, number, boolean, null>()) {
-		const auto &token{ previous() };
+		const auto token{ previous() };
 		const auto id{ token.literal_id };
 		if (id < std::size(ctx.literals)) {
-			return prog.emplace<expression_type::literal>(ctx.literals.at(id));
+			return prog.emplace<expression_type::literal>(prog.store(ctx.literals.at(id)));
 		}
 		throw make_error(
 			std::format(R"(Missing literal #{} of the "{}" token!)",
@@ -427,7 +566,7 @@ auto parser::primary(program &prog) -> expression_id {
 	}
 
 	if (match<left_paren>()) {
-		const auto &token{ peek() };
+		const auto token{ peek() };
 		auto expr_{ expr(prog) };
 
 		consume(right_paren, "Expected ')' after expression", token, error_code::pe_broken_symmetry);
@@ -448,10 +587,13 @@ void parser::synchronize() {
 			case kw_if: [[fallthrough]];
 			case kw_while: [[fallthrough]];
 			case kw_return: [[fallthrough]];
-			case semicolon: [[fallthrough]];
 			case right_brace:
 				return;
 
+			case semicolon:
+				advice();
+				return;
+
 			default: break;
 		}
 
@@ -459,33 +601,61 @@ void parser::synchronize() {
 	} while (!at_end());
 }
 
-auto parser::consume(token_type type, std::string_view on_error, const token &tok, error_code code) -> const token & {
+void parser::consume_end_of_statement() {
+	/// The closing brace belongs to the block, so it's left for the scope_stmt
+	if (check(token_type::right_brace)) {
+		make_error("It seems like there should be ';' before '}'",
+			error_code::pe_missing_end_of_statement, previous()
+		);
+		return;
+	}
+	consume(token_type::semicolon, "Expected ';' after statement", previous());
+}
+
+auto parser::consume(token_type type, std::string_view on_error, const token &tok, error_code code) -> token {
 	if (!check(type)) {
 		make_error(on_error, code, tok);
 	}
 	return advice();
 }
 
-auto parser::advice() -> const token & {
+auto parser::advice() -> token {
 	m_current += static_cast<size_t>(!at_end());
 	return previous();
 }
 
 auto parser::check(const token_type type) const -> bool {
-	return !at_end() && peek().type == type;
+	return !at_end() && type_at(m_current) == type;
 }
 
 auto parser::at_end() const -> bool {
 	/* m_current < std::size(m_tokens) || */
-	return peek().type == token_type::end_of_file;
+	return m_current >= m_end || type_at(m_current) == token_type::end_of_file;
+}
+
+auto parser::peek() const -> token {
+	return token_at(m_current);
+}
+
+auto parser::previous() const -> token {
+	return token_at(m_current - 1ull);
 }
 
-auto parser::peek() const -> const token & {
-	return ctx.tokens.at(m_current);
+auto parser::token_at(const size_t index) const -> token {
+	if (m_stream == nullptr) return ctx.tokens.at(index);
+
+	if (index == m_pulled) {
+		m_window[m_pulled++ % window_size] = m_stream->next();
+	}
+	if (index >= m_pulled || index + window_size < m_pulled) {
+		throw std::out_of_range{ "The token is out of the parser window" };
+	}
+	return m_window[index % window_size];
 }
 
-auto parser::previous() const -> const token & {
-	return ctx.tokens.at(m_current - 1ull);
+auto parser::type_at(const size_t index) const -> token_type {
+	if (m_stream == nullptr) return ctx.tokens.type_at(index);
+	return token_at(index).type;
 }
 
 auto parser::make_error(std::string_view msg, error_code code, const token &tok) const -> error {
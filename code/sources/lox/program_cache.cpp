@@ -0,0 +1,318 @@
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <format>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <type_traits>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "lox/program_cache.hpp"
+#include "lox/source_file.hpp"
+#include "lox/utils/strhash.hpp"
+
+namespace lox {
+
+namespace {
+
+/// Has to be bumped whenever token, literal or the layout of the file change
+constexpr uint32_t format_version{ 3u };
+constexpr std::array magic{ 'L', 'O', 'X', 'C' };
+
+template<class T>
+concept plain = std::is_trivially_copyable_v<T>;
+
+struct file_header {
+	std::array<char, 4> tag{ magic };
+	uint32_t version{ format_version };
+	uint64_t layout{ program::layout_hash };
+	uint64_t source_size{};
+	uint64_t source_hash{};
+	uint64_t payload_hash{}; /// of everything after the header, a damaged file is refused before it's read
+
+	[[nodiscard]] auto operator==(const file_header &other) const noexcept -> bool = default;
+};
+
+[[nodiscard]] auto header_of(const std::string_view source, const std::string_view payload) noexcept -> file_header {
+	return file_header{
+		.source_size  = std::size(source),
+		.source_hash  = utils::fnv1a_64(source),
+		.payload_hash = utils::fnv1a_64(payload)
+	};
+}
+
+/// The values are written as they lie in the memory, the cache is never moved to another machine
+class cache_writer {
+public:
+	template<plain T>
+	void write_value(const T &value) {
+		m_bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	void write_bytes(const std::string_view bytes) {
+		write_value(static_cast<uint64_t>(std::size(bytes)));
+		m_bytes.append(bytes);
+	}
+
+	template<plain T>
+	void write(const std::vector<T> &values) {
+		write_value(static_cast<uint64_t>(std::size(values)));
+		m_bytes.append(reinterpret_cast<const char *>(std::data(values)), std::size(values) * sizeof(T));
+	}
+
+	void write(const std::vector<literal> &values) {
+		write_value(static_cast<uint64_t>(std::size(values)));
+		for (const auto &value : values) {
+			write_value(value.type());
+			std::visit([this]<class T>(const T &alternative) {
+				if constexpr (std::is_same_v<T, std::string>) {
+					write_bytes(alternative);
+				} else if constexpr (!std::is_same_v<T, std::monostate>) {
+					write_value(alternative);
+				}
+			}, static_cast<const literal_base &>(value));
+		}
+	}
+
+	[[nodiscard]] auto bytes() const noexcept -> std::string_view { return m_bytes; }
+
+private:
+	std::string m_bytes{};
+};
+
+/// Every read checks the size left first, so a file which is cut short is refused instead of overrun
+class cache_reader {
+public:
+	explicit cache_reader(const std::string_view bytes) noexcept
+		: m_bytes{ bytes }
+	{}
+
+	template<plain T>
+	[[nodiscard]] auto read_value(T &value) noexcept -> bool {
+		if (std::size(m_bytes) < sizeof(T)) return false;
+
+		std::memcpy(&value, std::data(m_bytes), sizeof(T));
+		m_bytes.remove_prefix(sizeof(T));
+		return true;
+	}
+
+	[[nodiscard]] auto read_bytes(std::string_view &bytes) noexcept -> bool {
+		uint64_t size{};
+		if (!read_value(size) || std::size(m_bytes) < size) return false;
+
+		bytes = m_bytes.substr(0u, static_cast<size_t>(size));
+		m_bytes.remove_prefix(static_cast<size_t>(size));
+		return true;
+	}
+
+	template<plain T>
+	[[nodiscard]] auto read(std::vector<T> &values) -> bool {
+		uint64_t count{};
+		if (!read_value(count) || std::size(m_bytes) / sizeof(T) < count) return false;
+
+		const auto size{ static_cast<size_t>(count) * sizeof(T) };
+		values.resize(static_cast<size_t>(count));
+		if (size != 0u) {
+			std::memcpy(std::data(values), std::data(m_bytes), size);
+		}
+		m_bytes.remove_prefix(size);
+		return true;
+	}
+
+	[[nodiscard]] auto read(std::vector<literal> &values) -> bool {
+		uint64_t count{};
+		if (!read_value(count) || std::size(m_bytes) < count) return false;
+
+		values.resize(static_cast<size_t>(count));
+		for (auto &value : values) {
+			if (!read_literal(value)) return false;
+		}
+		return true;
+	}
+
+	[[nodiscard]] auto empty() const noexcept -> bool { return std::empty(m_bytes); }
+	[[nodiscard]] auto rest() const noexcept -> std::string_view { return m_bytes; }
+
+private:
+	std::string_view m_bytes;
+
+	template<class T>
+	[[nodiscard]] auto read_alternative(literal &value) noexcept -> bool {
+		T alternative{};
+		if (!read_value(alternative)) return false;
+
+		value = alternative;
+		return true;
+	}
+
+	[[nodiscard]] auto read_literal(literal &value) -> bool {
+		literal_type type{};
+		if (!read_value(type)) return false;
+
+		switch (type) {
+			using enum literal_type;
+
+			case null:     value = null_literal; return true;
+			case boolean:  return read_alternative<bool>(value);
+			case number:   return read_alternative<double>(value);
+			case integral: return read_alternative<int64_t>(value);
+			case string: {
+				std::string_view bytes{};
+				if (!read_bytes(bytes)) return false;
+
+				value = std::string{ bytes };
+				return true;
+			}
+
+			default:
+				break;
+		}
+		return false;
+	}
+};
+
+/// The lexemes are written in the order of their ids, so adding them back gives the same ones
+void write_lexemes(cache_writer &out, const lexeme_database &lexemes) {
+	out.write_value(static_cast<uint64_t>(std::size(lexemes)));
+	for (lexeme_id id{ 1u }; id <= std::size(lexemes); ++id) {
+		out.write_bytes(lexemes.get(id));
+	}
+}
+
+[[nodiscard]] auto read_lexemes(cache_reader &in, lexeme_database &lexemes) noexcept -> bool {
+	uint64_t count{};
+	if (!in.read_value(count)) return false;
+
+	for (uint64_t id{ 1u }; id <= count; ++id) {
+		std::string_view lexeme{};
+		if (!in.read_bytes(lexeme) || lexemes.add(lexeme) != id) return false;
+	}
+	return true;
+}
+
+/// The ids the program can't check itself: the tokens have to point into the lexemes and into the source
+struct node_validator {
+	size_t lexemes_count{};
+	size_t lines_count{};
+	size_t source_size{};
+
+	[[nodiscard]] auto operator()(const token &tok) const noexcept -> bool {
+		const auto known_type{ tok.type <= token_type::kw_super || tok.type == token_type::end_of_file };
+		const auto known_lexeme{ tok.lexeme_id == invalid_id || tok.lexeme_id <= lexemes_count };
+		return known_type && known_lexeme && tok.line <= lines_count && tok.position <= source_size;
+	}
+
+	[[nodiscard]] auto operator()(const coordinates &where) const noexcept -> bool {
+		return where.storage <= coordinates::kind::global;
+	}
+
+	/// The literals are checked while they're read
+	[[nodiscard]] auto operator()(const literal &) const noexcept -> bool { return true; }
+};
+
+/// Unique among the processes and the threads storing the caches at once, it's renamed in the same directory
+[[nodiscard]] auto temporary_path(const std::string &path) -> std::string {
+	static std::atomic<uint32_t> counter{};
+#if defined(_WIN32)
+	const auto process{ ::_getpid() };
+#else
+	const auto process{ ::getpid() };
+#endif
+	return std::format("{}.{}.{}.tmp", path, process, counter.fetch_add(1u, std::memory_order_relaxed));
+}
+
+[[nodiscard]] auto valid_lines(const line_index &lines, size_t source_size) noexcept -> bool {
+	return std::ranges::is_sorted(lines) && (std::empty(lines) || lines.back() < source_size);
+}
+
+} // namespace
+
+auto cache_path(const std::string_view script_path, const bool beside_script) -> std::string {
+	namespace fs = std::filesystem;
+
+#pragma warning(suppress: 4996)
+	if (const auto directory{ std::getenv("LOX_CACHE_DIR") }; directory != nullptr && *directory != '\0') {
+		std::error_code error{};
+		auto absolute{ fs::absolute(fs::path{ script_path }, error) };
+		if (error) {
+			absolute = fs::path{ script_path };
+		}
+
+		const auto name{ std::format("{:016x}.loxc", utils::fnv1a_64(std::string_view{ absolute.string() })) };
+		return (fs::path{ directory } / name).string();
+	}
+
+	return beside_script ? fs::path{ script_path }.replace_extension(".loxc").string() : std::string{};
+}
+
+auto load_cache(const std::string &path, const std::string_view source) -> std::optional<cached_program> {
+	const auto file{ source_file::open(path) };
+	if (!file.has_value()) {
+		return std::nullopt;
+	}
+
+	cache_reader in{ file->view() };
+	if (file_header header{}; !in.read_value(header) || header != header_of(source, in.rest())) {
+		return std::nullopt;
+	}
+
+	cached_program cached{};
+	if (!read_lexemes(in, cached.lexemes) || !in.read(cached.lines) || !cached.prog.deserialize(in) || !in.empty()) {
+		return std::nullopt;
+	}
+
+	/// The checksum doesn't stop a file made by hand, so nothing it refers to is trusted
+	const node_validator valid{
+		.lexemes_count = std::size(cached.lexemes),
+		.lines_count   = std::size(cached.lines),
+		.source_size   = std::size(source)
+	};
+	if (!valid_lines(cached.lines, std::size(source)) || !cached.prog.validate(valid)) {
+		return std::nullopt;
+	}
+	return cached;
+}
+
+auto store_cache(const std::string &path, const std::string_view source,
+	const program &prog, const lexeme_database &lexemes, const line_index &lines
+) -> bool {
+	namespace fs = std::filesystem;
+
+	cache_writer out{};
+	write_lexemes(out, lexemes);
+	out.write(lines);
+	prog.serialize(out);
+	const auto header{ header_of(source, out.bytes()) };
+
+	std::error_code error{};
+	if (const auto directory{ fs::path{ path }.parent_path() }; !std::empty(directory)) {
+		fs::create_directories(directory, error);
+	}
+
+	const auto temporary{ temporary_path(path) };
+	std::ofstream stream{ temporary, std::ios::binary | std::ios::trunc };
+	const auto bytes{ out.bytes() };
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.write(std::data(bytes), static_cast<std::streamsize>(std::size(bytes)));
+	stream.close();
+	if (!stream) {
+		fs::remove(temporary, error);
+		return false;
+	}
+
+	fs::rename(temporary, path, error);
+	if (error) {
+		fs::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+} // namespace lox
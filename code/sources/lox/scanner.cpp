@@ -1,35 +1,166 @@
 #include <array>
 #include <format>
+#include <future>
 #include <ranges>
+#include <thread>
 #include <algorithm>
 #include <unordered_map>
 
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 #include "lox/scanner.hpp"
+#include "lox/constants.hpp"
 
 #include "lox/types/token.hpp"
 #include "lox/types/literal.hpp"
-#include "lox/utils/strhash.hpp"
+#include "lox/utils/charscan.hpp"
 #include "lox/utils/strutils.hpp"
 
 namespace lox {
 
 scanner::scanner(const std::string_view script, error_handler &err)
 	: errout{ err }
+	, m_source{ script }
 	, m_script{ lox::utils::strip(script) }
 {}
 
+scanner::scanner(chunk_reader reader, error_handler &err)
+	: errout{ err }
+	, m_reader{ std::move(reader) }
+{}
+
 auto scanner::scan() -> output_type {
 	output_type output{};
+	if (!start(output)) return output;
+
+	uint32_t position{};
+	while (ensure(position)) {
+		position = next_token(position, output);
+		index_scanned(output.lines, position);
+	}
+	index_lines(output.lines, static_cast<uint32_t>(std::size(m_source)));
+
+	output.tokens.emplace_back(m_line, absolute(position), invalid_id, invalid_id, token_type::end_of_file);
+
+	return output;
+}
+
+auto scanner::scan_parallel(size_t jobs) -> output_type {
+	if (jobs == 0u) {
+		jobs = std::thread::hardware_concurrency();
+	}
+	jobs = (std::min)(jobs, std::size(m_script) / constants::parallel_scan_min_chunk);
+	if (m_reader || jobs < 2u) {
+		return scan();
+	}
+
+	output_type output{};
+	if (!start(output)) return output;
+
+	std::vector<uint32_t> bounds{ 0u };
+	for (size_t job{ 1u }; job < jobs; ++job) {
+		const auto eol{ m_script.find('\n', std::size(m_script) * job / jobs) };
+		if (eol == std::string_view::npos) break;
+
+		if (const auto bound{ static_cast<uint32_t>(eol + 1u) }; bound > bounds.back() && bound < end_position()) {
+			bounds.emplace_back(bound);
+		}
+	}
+	bounds.emplace_back(end_position());
+
+	std::vector<std::future<chunk_output>> chunks;
+	chunks.reserve(std::size(bounds) - 1u);
+	for (size_t i{ 1u }; i < std::size(bounds); ++i) {
+		chunks.emplace_back(std::async(std::launch::async, &scanner::scan_chunk, this, bounds[i - 1u], bounds[i], 0u));
+	}
+
+	uint32_t position{};
+	for (size_t i{}; i < std::size(chunks); ++i) {
+		auto chunk{ chunks[i].get() };
+		/// The previous chunk has ended with a string or a comment which covers this one
+		if (position >= bounds[i + 1u]) continue;
+
+		auto synced{ std::ranges::find(chunk.steps, position, &scan_step::position) };
+		if (synced == std::end(chunk.steps)) {
+			chunk = scan_chunk(position, bounds[i + 1u], m_line);
+			synced = std::begin(chunk.steps);
+		}
+
+		/// The lines are unsigned, so the offset might wrap around and back
+		const auto line_offset{ m_line - synced->line };
+		merge_chunk(output, chunk, *synced, line_offset);
+
+		position = chunk.position;
+		m_line = chunk.line + line_offset;
+	}
+
+	m_indexed = source_position(position);
+	index_lines(output.lines, static_cast<uint32_t>(std::size(m_source)));
+
+	output.tokens.emplace_back(m_line, absolute(position), invalid_id, invalid_id, token_type::end_of_file);
+
+	return output;
+}
+
+auto scanner::next() -> token {
+	auto &tokens{ m_output.tokens };
+	tokens.clear();
+
+	if (!m_started && !start(m_output)) {
+		return token{ m_line, 0u, invalid_id, invalid_id, token_type::end_of_file };
+	}
+
+	while (std::empty(tokens)) {
+		discard_scanned();
+		if (!ensure(m_position)) {
+			return token{ m_line, absolute(m_position), invalid_id, invalid_id, token_type::end_of_file };
+		}
+		m_position = next_token(m_position, m_output);
+	}
+
+	return tokens.front();
+}
+
+auto scanner::descriptor_reader(const int descriptor) -> chunk_reader {
+	return [descriptor](std::span<char> chunk) -> size_t {
+#if defined(_WIN32)
+		const auto read_bytes{ ::_read(descriptor, std::data(chunk), static_cast<uint32_t>(std::size(chunk))) };
+#else
+		const auto read_bytes{ ::read(descriptor, std::data(chunk), std::size(chunk)) };
+#endif
+		return read_bytes > 0 ? static_cast<size_t>(read_bytes) : 0ull;
+	};
+}
+
+auto scanner::start(output_type &output) -> bool {
+	m_started = true;
+	m_line = 0u;
+
+	if (m_reader) {
+		/// The same as the strip of the whole script: the leading whitespaces aren't the part of the source
+		while (ensure(0u)) {
+			if (const auto from{ m_buffer.find_first_not_of(utils::whitespaces) }; from != std::string::npos) {
+				m_buffer.erase(0u, from);
+				m_script = m_buffer;
+				break;
+			}
+			m_buffer.clear();
+			m_script = m_buffer;
+		}
+	}
 
 	if (std::empty(m_script)) {
 		errout.report("No source was given!", error_record{
 			.code    = error_code::se_no_sources,
 			.line    = m_line,
 		});
-		return output;
+		return false;
 	}
 
-	const auto end_pos{ end_position() };
 	// Common used shit
 	output.literals = std::vector<literal>{
 		{ /*null*/ }, true, false,
@@ -38,33 +169,105 @@ auto scanner::scan() -> output_type {
 		int64_t{},
 	};
 
-	m_line = 0u;
-	uint32_t position{};
-	while (position != end_pos) {
-		position = next_token(position, output);
+	/// The leading whitespaces, the rest is indexed while it's scanned
+	m_indexed = 0u;
+	index_lines(output.lines, source_position(0u));
+
+	m_literal_ids.clear();
+	for (size_t id{}; id < std::size(output.literals); ++id) {
+		m_literal_ids.emplace(hash_of(output.literals[id]), static_cast<uint32_t>(id));
+	}
+	return true;
+}
+
+auto scanner::ensure(const uint32_t position) -> bool {
+	while (position >= end_position()) {
+		if (!m_reader) return false;
+
+		const auto size{ std::size(m_buffer) };
+		m_buffer.resize(size + constants::source_chunk_size);
+		const auto read_bytes{ m_reader(std::span{ m_buffer }.subspan(size)) };
+		m_buffer.resize(size + read_bytes);
+		m_script = m_buffer;
+
+		if (read_bytes == 0ull) {
+			m_reader = nullptr;
+			return false;
+		}
 	}
+	return true;
+}
 
-	output.tokens.emplace_back(m_line, position, invalid_id, invalid_id, token_type::end_of_file);
+void scanner::discard_scanned() {
+	/// The scanned part is dropped by whole chunks, so the buffer stays about a chunk long
+	if (m_position < constants::source_chunk_size) return;
 
-	return output;
+	m_buffer.erase(0u, m_position);
+	m_script = m_buffer;
+	m_base += m_position;
+	m_position = 0u;
+}
+
+template<class Scan>
+auto scanner::scan_through(uint32_t from, Scan scan) -> utils::scan_result {
+	uint32_t new_lines{};
+	while (true) {
+		const auto [position, lines]{ scan(m_script, from) };
+		new_lines += lines;
+
+		from = static_cast<uint32_t>(position);
+		if (from < end_position() || !ensure(from)) {
+			return utils::scan_result{ from, new_lines };
+		}
+	}
 }
 
 auto scanner::end_position() const noexcept -> uint32_t {
 	return static_cast<uint32_t>(std::size(m_script));
 }
 
+auto scanner::absolute(const uint32_t position) const noexcept -> uint32_t {
+	return m_base + position;
+}
+
+auto scanner::source_position(const uint32_t position) const noexcept -> uint32_t {
+	if (std::empty(m_source)) return position;
+	return static_cast<uint32_t>(std::data(m_script) - std::data(m_source)) + position;
+}
+
+/// The streamed sources aren't indexed, only the given script is kept as a whole
+void scanner::index_lines(line_index &lines, const uint32_t till) {
+	if (std::empty(m_source)) return;
+
+	const auto indexed{ m_source.substr(0u, till) };
+	for (auto from{ utils::charscan::find(indexed, m_indexed, '\n').position };
+		from < std::size(indexed);
+		from = utils::charscan::find(indexed, from + 1u, '\n').position
+	) {
+		lines.emplace_back(static_cast<uint32_t>(from));
+	}
+	m_indexed = (std::max)(m_indexed, static_cast<uint32_t>(std::size(indexed)));
+}
+
+void scanner::index_scanned(line_index &lines, const uint32_t position) {
+	if (const auto till{ source_position(position) }; till >= m_indexed + constants::line_index_batch) {
+		index_lines(lines, till);
+	}
+}
+
 auto scanner::next_token(uint32_t pos, output_type &output) -> uint32_t {
 	constexpr uint32_t symbol_size{ static_cast<uint32_t>(sizeof(char)) };
 
 	pos = skip_whitespaces(pos);
+	if (!ensure(pos)) return pos;
 
 	const auto symbol{ m_script[pos] };
-	const auto add_token{ [&tokens{ output.tokens }, line{ m_line }, pos] (auto type, uint32_t offset = 1u) {
-		tokens.emplace_back(line, pos, invalid_id, invalid_id, type);
+	const auto add_token{ [&tokens{ output.tokens }, line{ m_line }, at{ absolute(pos) }, pos] (auto type, uint32_t offset = 1u) {
+		tokens.emplace_back(line, at, invalid_id, invalid_id, type);
 		return pos + offset;
 	} };
-	const auto next_is{ [&script{ m_script }, pos, end{ end_position() }](const auto expected) {
-		if (pos + symbol_size < end && script[pos + 1] == expected) {
+	const auto next_is{ [this, pos](const auto expected) {
+		if (ensure(pos + symbol_size) && m_script[pos + 1] == expected) {
 			return 1u;
 		}
 		return 0u;
@@ -135,9 +338,6 @@ auto scanner::next_token(uint32_t pos, output_type &output) -> uint32_t {
 	}
 
 	if (std::isalpha(symbol) || symbol == '_') {
-		if (auto next_pos{ try_parse_null_or_boolean(pos, output) }; next_pos.has_value()) {
-			return next_pos.value();
-		}
 		return parse_identifier_token(pos, output);
 	}
 
@@ -146,31 +346,101 @@ auto scanner::next_token(uint32_t pos, output_type &output) -> uint32_t {
 	return pos + symbol_size; // keep going
 }
 
-auto scanner::parse_string_token(const uint32_t pos, output_type &output) -> uint32_t {
-	const auto end{ end_position() };
+auto scanner::scan_chunk(const uint32_t from, const uint32_t till, const uint32_t line) const -> chunk_output {
+	chunk_output chunk{};
+
+	scanner worker{ std::string_view{}, errout };
+	worker.m_source = m_source;
+	worker.m_script = m_script;
+	worker.m_line = line;
+	worker.m_indexed = source_position(from);
+	worker.m_deferred = &chunk.errors;
+
+	auto &tokens{ chunk.output.tokens };
+	auto position{ from };
+	chunk.steps.emplace_back(position, worker.m_line, 0u, 0u);
+
+	while (position < till && worker.ensure(position)) {
+		position = worker.next_token(position, chunk.output);
+		worker.index_scanned(chunk.output.lines, position);
+		if (position < from + constants::parallel_scan_sync_window) {
+			chunk.steps.emplace_back(position, worker.m_line, std::size(tokens), std::size(chunk.errors));
+		}
+	}
+	worker.index_lines(chunk.output.lines, source_position(position));
 
-	auto cur{ pos + 1u };
-	uint32_t lines_count{};
-	while (cur < end && m_script[cur] != '"') {
-		lines_count += static_cast<uint32_t>(m_script[cur] == '\n');
-		++cur;
+	chunk.position = position;
+	chunk.line = worker.m_line;
+	return chunk;
+}
+
+void scanner::merge_chunk(output_type &output, chunk_output &chunk, const scan_step &from, const uint32_t line_offset) {
+	const auto &lexemes{ chunk.output.lexemes };
+	auto &literals{ chunk.output.literals };
+
+	/// The ids are given in the order of the first use, just like the serial scan does
+	std::vector<uint32_t> lexeme_ids{};
+	std::vector<uint32_t> literal_ids(std::size(literals), invalid_id);
+
+	output.tokens.append(chunk.output.tokens, from.tokens, line_offset, [&](const token_type type, const uint32_t id) {
+		if (id == invalid_id) return id;
+
+		if (type == token_type::identifier) {
+			if (id >= std::size(lexeme_ids)) {
+				lexeme_ids.resize(id + 1u, invalid_id);
+			}
+			if (lexeme_ids[id] == invalid_id) {
+				lexeme_ids[id] = static_cast<uint32_t>(output.lexemes.add(lexemes.get(id)));
+			}
+			return lexeme_ids[id];
+		}
+
+		if (literal_ids[id] == invalid_id) {
+			literal_ids[id] = emplace_literal(std::move(literals[id]), output.literals);
+		}
+		return literal_ids[id];
+	});
+
+	/// The previous chunk has indexed the lines till the synced step
+	const auto &lines{ chunk.output.lines };
+	output.lines.insert(std::end(output.lines), std::ranges::lower_bound(lines, source_position(from.position)), std::end(lines));
+
+	for (auto i{ from.errors }; i < std::size(chunk.errors); ++i) {
+		auto &[message, record]{ chunk.errors[i] };
+		record.line += line_offset;
+		errout.report(message, record);
+	}
+}
+
+void scanner::report(const std::string_view message, error_record record) const {
+	if (m_deferred != nullptr) {
+		m_deferred->emplace_back(std::string{ message }, record);
+		return;
 	}
+	errout.report(message, record);
+}
+
+auto scanner::parse_string_token(const uint32_t pos, output_type &output) -> uint32_t {
+	const auto [closing, lines_count]{ scan_through(pos + 1u, [](std::string_view script, size_t from) {
+		return utils::charscan::find(script, from, '"');
+	}) };
+	const auto cur{ static_cast<uint32_t>(closing) };
 
-	if (cur == end) {
+	if (cur == end_position()) {
 		++m_line;
 
-		errout.report(R"(Unclosed string literal! No '"' was found)", error_record{
+		report(R"(Unclosed string literal! No '"' was found)", error_record{
 			.code = error_code::se_broken_symmetry,
 			.line    = m_line,
-			.from    = pos,
-			.to      = static_cast<uint16_t>(pos + 1)
+			.from    = absolute(pos),
+			.to      = static_cast<uint16_t>(absolute(pos) + 1)
 		});
 
 		return skip_till(';', pos + 1);
 	}
 
 	const auto id{ emplace_literal(std::string{ m_script.substr(pos + 1u, cur - pos - 1u) }, output.literals) };
-	output.tokens.emplace_back(m_line, pos, id, invalid_id, token_type::string);
+	output.tokens.emplace_back(m_line, absolute(pos), id, invalid_id, token_type::string);
 
 	m_line += lines_count;
 
@@ -178,130 +448,87 @@ auto scanner::parse_string_token(const uint32_t pos, output_type &output) -> uin
 }
 
 auto scanner::parse_number_token(const uint32_t pos, output_type &output) -> uint32_t {
-	const auto end{ end_position() };
 	static constexpr auto is_digit_or_single_quote{ [](const char c) {
 		return std::isdigit(c) || c == '\'';
 	} };
 
 	auto cur{ pos + 1 };
-	while (cur < end && is_digit_or_single_quote(m_script[cur])) {
+	while (ensure(cur) && is_digit_or_single_quote(m_script[cur])) {
 		++cur;
 	}
-	if (m_script[cur] == '.') {
+	if (ensure(cur) && m_script[cur] == '.') {
 		++cur;
-		while (cur < end && is_digit_or_single_quote(m_script[cur])) {
+		while (ensure(cur) && is_digit_or_single_quote(m_script[cur])) {
 			++cur;
 		}
 	}
 
 	const auto id{ emplace_literal(to_number_literal(m_script.substr(pos, cur - pos)), output.literals) };
-	output.tokens.emplace_back(m_line, pos, id, invalid_id, token_type::number);
+	output.tokens.emplace_back(m_line, absolute(pos), id, invalid_id, token_type::number);
 
 	return cur;
 }
 
 auto scanner::parse_identifier_token(uint32_t pos, output_type &output) -> uint32_t {
-	const auto end{ end_position() };
-
-	auto cur{ pos + 1u };
-	while (cur != end && (std::isalnum(m_script[cur]) || m_script[cur] == '_')) {
-		++cur;
-	}
+	const auto cur{ scan_through(pos + 1u, [](std::string_view script, size_t from) {
+		return utils::scan_result{ utils::charscan::skip_identifier(script, from) };
+	}).position };
 	const auto lexeme{ m_script.substr(pos, cur - pos) };
 	const auto type{ from_keyword(lexeme) };
-	uint16_t lexeme_id{ invalid_id };
-	if (type == token_type::identifier) {
-		lexeme_id = output.lexemes.add(lexeme);
-	}
-
-	output.tokens.emplace_back(m_line, pos, invalid_id, lexeme_id, type);
-
-	return cur;
-}
-
-auto scanner::try_parse_null_or_boolean(uint32_t pos, output_type &output) -> std::optional<uint32_t> {
-	if (constexpr std::string_view check{ "ntf" }; check.find(m_script[pos]) == std::string_view::npos) {
-		return std::nullopt;
-	}
-
-	const auto end{ end_position() };
-
-	constexpr auto is_punct_or_space_except_underscore{ [](auto symbol) {
-		return !((std::ispunct(symbol) && symbol != '_') || std::isspace(symbol));
-	} };
-
-	auto cur{ pos + 1u };
-	while (cur != end && is_punct_or_space_except_underscore(m_script[cur])) {
-		++cur;
-	}
-
-	const size_t len{ static_cast<size_t>(cur - pos) };
+	uint32_t literal_id{ invalid_id };
+	uint32_t lexeme_id{ invalid_id };
 
-	switch (const auto identifier{ m_script.substr(pos, len) }; utils::fnv1a(identifier)) {
-		using namespace utils::fnv1a_literals;
-		case "null"_fnv1a:
-			output.tokens.emplace_back(
-				m_line, pos, emplace_literal({}, output.literals), invalid_id, token_type::null
-			);
+	switch (type) {
+		case token_type::identifier:
+			lexeme_id = static_cast<uint32_t>(output.lexemes.add(lexeme));
 			break;
-
-		case "true"_fnv1a:
-			output.tokens.emplace_back(
-				m_line, pos, emplace_literal(true, output.literals), invalid_id, token_type::boolean
-			);
+		case token_type::null:
+			literal_id = emplace_literal({}, output.literals);
 			break;
-
-		case "false"_fnv1a:
-			output.tokens.emplace_back(
-				m_line, pos, emplace_literal(false, output.literals), invalid_id, token_type::boolean
-			);
+		case token_type::boolean:
+			literal_id = emplace_literal(lexeme == "true", output.literals);
 			break;
 
-		default:
-			return std::nullopt;
+		default: break;
 	}
 
+	output.tokens.emplace_back(m_line, absolute(pos), literal_id, lexeme_id, type);
+
 	return cur;
 }
 
-auto scanner::skip_till(const char matches, uint32_t pos) const noexcept -> uint32_t {
-	const auto end{ end_position() };
-	while (pos < end && m_script[pos] != matches) {
-		++pos;
-	}
-	return pos;
+auto scanner::skip_till(const char matches, uint32_t pos) -> uint32_t {
+	return scan_through(pos, [matches](std::string_view script, size_t from) {
+		return utils::charscan::find(script, from, matches);
+	}).position;
 }
 
-auto scanner::skip_whitespaces(uint32_t pos) noexcept -> uint32_t {
-	for (const auto end{ end_position() }; pos < end; ++pos) {
-		if (const auto ch{ m_script[pos] }; std::isspace(m_script[pos])) {
-			if (ch == '\n') ++m_line;
-			continue;
-		}
-		break;
+auto scanner::skip_whitespaces(uint32_t pos) -> uint32_t {
+	const auto [next, new_lines]{ scan_through(pos, &utils::charscan::skip_spaces) };
+	/// The trailing whitespaces aren't the part of the source, so their lines aren't counted
+	if (ensure(next)) {
+		m_line += new_lines;
 	}
-	return pos;
+	return next;
 }
 
-auto scanner::skip_multiline_comment(uint32_t pos) noexcept -> uint32_t {
-	const auto end{ end_position() };
-
-	++pos;
-	while (pos < end && m_script[pos] != '/' && m_script[pos - 1] != '*') {
-		m_line += static_cast<uint32_t>(m_script[pos] == '\n');
-		++pos;
-	}
+auto scanner::skip_multiline_comment(uint32_t pos) -> uint32_t {
+	if (!ensure(++pos)) return pos;
 
-	return pos;
+	const auto [next, new_lines]{ scan_through(pos, &utils::charscan::find_comment_end) };
+	m_line += new_lines;
+	return next;
 }
 
-auto scanner::emplace_literal(literal lit, std::vector<literal> &out) -> uint16_t {
-	if (auto found{ std::ranges::find(out, lit) }; found != std::end(out)) {
-		return static_cast<uint16_t>(std::distance(std::begin(out), found));
+auto scanner::emplace_literal(literal lit, std::vector<literal> &out) -> uint32_t {
+	const auto hash{ hash_of(lit) };
+	for (auto [it, end]{ m_literal_ids.equal_range(hash) }; it != end; ++it) {
+		if (out[it->second] == lit) return it->second;
 	}
 
-	const auto id{ static_cast<uint16_t>(std::size(out)) };
+	const auto id{ static_cast<uint32_t>(std::size(out)) };
 	out.emplace_back(std::move(lit));
+	m_literal_ids.emplace(hash, id);
 	return id;
 }
 
@@ -313,11 +540,11 @@ void scanner::make_error_unexpected_symbol(const uint32_t pos) const {
 	stack_string[symbol_pos] = m_script[pos];
 
 	const std::string_view message{ std::data(stack_string), std::size(stack_string) - 1ull };
-	errout.report(message, error_record{
+	report(message, error_record{
 		.code    = error_code::se_no_sources,
 		.line    = m_line,
-		.from    = pos,
-		.to      = pos + 1u
+		.from    = absolute(pos),
+		.to      = absolute(pos) + 1u
 	});
 }
 
@@ -0,0 +1,136 @@
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "lox/source_file.hpp"
+
+namespace lox {
+
+namespace {
+
+auto failure(const std::string_view message, const std::string &path) -> tl::unexpected<std::string> {
+	std::string text{ "Failed to " };
+	text.append(message).append(R"( ")").append(path).append(R"(": )").append(std::strerror(errno));
+	return tl::unexpected{ std::move(text) };
+}
+
+#if !defined(_WIN32)
+
+auto read_all(const int descriptor, std::string &out) -> bool {
+	constexpr size_t chunk_size{ 64 * 1024 };
+
+	for (;;) {
+		const auto size{ std::size(out) };
+		out.resize(size + chunk_size);
+
+		const auto read_bytes{ ::read(descriptor, std::data(out) + size, chunk_size) };
+		if (read_bytes < 0 && errno == EINTR) {
+			out.resize(size);
+			continue;
+		}
+
+		out.resize(size + static_cast<size_t>((std::max)(read_bytes, ssize_t{ 0 })));
+		if (read_bytes <= 0) return read_bytes == 0;
+	}
+}
+
+#endif // !defined(_WIN32)
+
+} // namespace
+
+source_file::source_file(std::string path) noexcept
+	: m_path{ std::move(path) }
+{}
+
+source_file::source_file(source_file &&other) noexcept {
+	*this = std::move(other);
+}
+
+auto source_file::operator=(source_file &&other) noexcept -> source_file & {
+	if (this == &other) return *this;
+
+	unmap();
+	m_path    = std::move(other.m_path);
+	m_content = std::move(other.m_content);
+	m_mapped  = std::exchange(other.m_mapped, false);
+	/// The short content lives inside of the string object, so the view follows it
+	m_view    = m_mapped ? std::exchange(other.m_view, {}) : std::string_view{ m_content };
+	other.m_view = {};
+
+	return *this;
+}
+
+source_file::~source_file() {
+	unmap();
+}
+
+auto source_file::open(std::string path) -> tl::expected<source_file, std::string> {
+	source_file file{ std::move(path) };
+
+#if defined(_WIN32)
+	std::ifstream stream{ file.m_path, std::ios::binary };
+	if (!stream) {
+		return failure("open file", file.m_path);
+	}
+	file.m_content.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+	file.m_view = file.m_content;
+#else
+	const auto descriptor{ ::open(file.m_path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (descriptor == -1) {
+		return failure("open file", file.m_path);
+	}
+
+	struct stat info{};
+	if (::fstat(descriptor, &info) == -1) {
+		auto error{ failure("read file", file.m_path) };
+		::close(descriptor);
+		return error;
+	}
+
+	const auto size{ static_cast<size_t>(info.st_size) };
+	if (S_ISREG(info.st_mode) && size > 0u) {
+		if (const auto data{ ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0) }; data != MAP_FAILED) {
+			::madvise(data, size, MADV_SEQUENTIAL);
+			file.m_view = std::string_view{ static_cast<const char *>(data), size };
+			file.m_mapped = true;
+		}
+	}
+
+	if (!file.m_mapped) {
+		if (!read_all(descriptor, file.m_content)) {
+			auto error{ failure("read file", file.m_path) };
+			::close(descriptor);
+			return error;
+		}
+		file.m_view = file.m_content;
+	}
+
+	/// The mapping keeps its own reference to the file
+	::close(descriptor);
+#endif
+
+	return file;
+}
+
+void source_file::unmap() noexcept {
+#if !defined(_WIN32)
+	if (m_mapped) {
+		::munmap(const_cast<char *>(std::data(m_view)), std::size(m_view));
+	}
+#endif
+	m_mapped = false;
+	m_view = {};
+}
+
+} // namespace lox
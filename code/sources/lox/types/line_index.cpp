@@ -0,0 +1,29 @@
+#include <algorithm>
+
+#include "lox/types/line_index.hpp"
+#include "lox/utils/charscan.hpp"
+
+namespace lox {
+
+auto make_line_index(const std::string_view script) -> line_index {
+	line_index index{};
+	for (size_t from{}; from < std::size(script); ++from) {
+		from = utils::charscan::find(script, from, '\n').position;
+		if (from < std::size(script)) {
+			index.emplace_back(static_cast<uint32_t>(from));
+		}
+	}
+	return index;
+}
+
+auto last_line_end(const std::span<const uint32_t> index, const size_t position) noexcept -> size_t {
+	const auto found{ std::ranges::upper_bound(index, position) };
+	return found != std::begin(index) ? *std::prev(found) : std::string_view::npos;
+}
+
+auto next_line_end(const std::span<const uint32_t> index, const size_t position) noexcept -> size_t {
+	const auto found{ std::ranges::lower_bound(index, position) };
+	return found != std::end(index) ? *found : std::string_view::npos;
+}
+
+} // namespace lox
@@ -1,3 +1,6 @@
+#include <bit>
+#include <array>
+
 #include <fast_float/fast_float.h>
 #include <fast_float/parse_number.h>
 
@@ -84,4 +87,25 @@ auto to_string(const literal &lit) -> std::string {
 	return "null";
 }
 
+auto hash_of(const literal &lit) noexcept -> hash_type {
+	const auto bytes_hash{ [](const auto value) {
+		const auto bytes{ std::bit_cast<std::array<uint8_t, sizeof(value)>>(value) };
+		return utils::fnv1a(std::span<const uint8_t>{ bytes });
+	} };
+
+	hash_type hash{ utils::offset_basis };
+	switch (lit.type()) {
+		using enum literal_type;
+
+		case boolean:  hash = bytes_hash(*lit.as<bool>()); break;
+		case number:   hash = bytes_hash(*lit.as<double>()); break;
+		case integral: hash = bytes_hash(*lit.as<int64_t>()); break;
+		case string:   hash = utils::fnv1a(std::string_view{ *lit.as<std::string>() }); break;
+
+		default: break;
+	}
+
+	return hash ^ static_cast<hash_type>(lit.index());
+}
+
 } // namespace lox
@@ -18,34 +18,37 @@ auto add_native_functions(lexeme_database &db, execution::environment &env) -> s
 	;
 }
 
-auto fn_print_impl(void *, std::span<const literal> args) -> literal {
+auto fn_print_impl(value_heap &, std::span<const value> args) -> value {
 	for (const auto &arg : args) {
 		switch (arg.type()) {
 			using enum literal_type;
 
-			case null:     std::fprintf(stdout, "null");
-			case boolean:  std::fprintf(stdout, (std::get<bool>(arg) ? "true" : "false")); break;
-			case number:   std::fprintf(stdout, "%f", std::get<double>(arg)); break;
-			case integral: std::fprintf(stdout, "%lld", std::get<int64_t>(arg)); break;
-			case string:   std::fprintf(stdout, "%s", std::data(std::get<std::string>(arg))); break;
+			case null:     std::fprintf(stdout, "null"); break;
+			case boolean:  std::fprintf(stdout, (arg.as_boolean() ? "true" : "false")); break;
+			case number:   std::fprintf(stdout, "%f", arg.as_number()); break;
+			case integral: std::fprintf(stdout, "%lld", arg.as_integral()); break;
+			case string: {
+				const auto str{ arg.as_string() };
+				std::fprintf(stdout, "%.*s", static_cast<int32_t>(std::size(str)), std::data(str));
+			} break;
 
 			default: break;
 		}
 	}
-	return null_literal;
+	return value::null();
 }
 
-auto fn_println_impl(void *_, std::span<const literal> args) -> literal {
-	fn_print_impl(_, args);
+auto fn_println_impl(value_heap &heap, std::span<const value> args) -> value {
+	std::ignore = fn_print_impl(heap, args);
 	std::fprintf(stdout, "\n");
-	return null_literal;
+	return value::null();
 }
 
-auto fn_time_now_impl(void *, std::span<const literal>) -> literal {
+auto fn_time_now_impl(value_heap &heap, std::span<const value>) -> value {
 	using i64_milli = std::chrono::duration<int64_t, std::milli>;
-	return std::chrono::duration_cast<i64_milli>(
+	return heap.integral(std::chrono::duration_cast<i64_milli>(
 		std::chrono::high_resolution_clock::now().time_since_epoch()
-	).count();
+	).count());
 }
 
 } // namespace lox::native
@@ -0,0 +1,144 @@
+#include <array>
+#include <cassert>
+#include <algorithm>
+
+#include "lox/types/value.hpp"
+#include "lox/utils/strutils.hpp"
+
+namespace lox {
+
+void value::destroy() noexcept {
+	switch (get_tag()) {
+		case tag::wide_integral: delete pointer<wide_integral_object>(); break;
+		case tag::string: {
+			const auto str{ pointer<string_object>() };
+			if (str->table != nullptr) str->table->erase(str->chars);
+			delete str;
+		} break;
+		case tag::slice: {
+			const auto piece{ pointer<slice_object>() };
+			if (--piece->buffer->references == 0u) delete piece->buffer;
+			delete piece;
+		} break;
+
+		default: break;
+	}
+}
+
+
+value_heap::~value_heap() {
+	/// The strings might outlive the heap, they must not reach for the table then
+	if (m_interned == nullptr) return;
+	for (const auto &[_, str] : *m_interned) {
+		str->table = nullptr;
+	}
+}
+
+auto value_heap::integral(int64_t num) -> value {
+	if (value::fits_inline(num)) {
+		return value::integral(num);
+	}
+	return reference(value::tag::wide_integral, new value::wide_integral_object{ {}, num });
+}
+
+auto value_heap::string(std::string_view str) -> value {
+	if (value::fits_inline(str)) {
+		return value::short_string(str);
+	}
+
+	if (const auto found{ m_interned->find(str) }; found != std::end(*m_interned)) {
+		const auto interned{ reference(value::tag::string, found->second) };
+		interned.retain();
+		return interned;
+	}
+
+	const auto stored{ new value::string_object{ {}, m_interned.get(), std::string{ str } } };
+	m_interned->emplace(std::string_view{ stored->chars }, stored);
+	return reference(value::tag::string, stored);
+}
+
+auto value_heap::concat(const value lhv, const value rhv) -> value {
+	const auto head{ lhv.as_string() };
+	const auto tail{ rhv.as_string() };
+	const auto length{ std::size(head) + std::size(tail) };
+
+	if (length <= value::short_string_capacity) {
+		std::array<char, value::short_string_capacity> chars{};
+		auto [_, pos]{ std::ranges::copy(head, std::begin(chars)) };
+		std::ranges::copy(tail, pos);
+		return value::short_string(std::string_view{ std::data(chars), length });
+	}
+
+	if (lhv.get_tag() == value::tag::slice) {
+		const auto &piece{ *lhv.pointer<value::slice_object>() };
+		auto &buffer{ *piece.buffer };
+
+		/// Nobody has appended to the buffer after the left slice, so it's ours to grow.
+		/// When the left slice is the only one, whatever follows it is dead and is dropped.
+		/// The tail might be a view of the same buffer, but never of the dropped part
+		if (piece.length == std::size(buffer.chars) || buffer.references == 1u) {
+			buffer.chars.resize(piece.length);
+			buffer.chars.append(tail);
+			++buffer.references;
+			return reference(value::tag::slice, new value::slice_object{ {}, &buffer, length });
+		}
+	}
+
+	const auto buffer{ new value::buffer_object{} };
+	buffer->chars.reserve(length);
+	buffer->chars.append(head).append(tail);
+	return reference(value::tag::slice, new value::slice_object{ {}, buffer, length });
+}
+
+auto value_heap::make(const literal &lit) -> value {
+	switch (lit.type()) {
+		using enum literal_type;
+
+		case boolean:  return value::boolean(*lit.as<bool>());
+		case number:   return value::number(*lit.as<double>());
+		case integral: return this->integral(*lit.as<int64_t>());
+		case string:   return this->string(*lit.as<std::string>());
+
+		default: break;
+	}
+	return value::null();
+}
+
+/// The value adopts the reference the object was made with
+auto value_heap::reference(value::tag t, const void *object) noexcept -> value {
+	const auto address{ reinterpret_cast<uintptr_t>(object) };
+	assert((address & ~value::payload_mask) == 0ull && "The address doesn't fit the payload");
+	return value{ t, static_cast<uint64_t>(address) };
+}
+
+
+auto to_literal(const value val) -> literal {
+	switch (val.type()) {
+		using enum literal_type;
+
+		case boolean:  return literal{ val.as_boolean() };
+		case number:   return literal{ val.as_number() };
+		case integral: return literal{ val.as_integral() };
+		case string:   return literal{ std::string{ val.as_string() } };
+
+		default: break;
+	}
+	return literal{};
+}
+
+auto to_string(const value val) -> std::string {
+	switch (val.type()) {
+		using enum literal_type;
+
+		case boolean:  return val.as_boolean() ? "true" : "false";
+		case number:   return std::to_string(val.as_number());
+		case integral: return std::to_string(val.as_integral());
+		case string:   return utils::quoted(val.as_string());
+
+		default: break;
+	}
+
+	return "null";
+}
+
+} // namespace lox
@@ -0,0 +1,133 @@
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOX_CHARSCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "lox/utils/charscan.hpp"
+
+namespace lox::utils::charscan {
+
+namespace {
+
+#if defined(LOX_CHARSCAN_SSE2)
+
+using block = __m128i;
+constexpr size_t block_size{ sizeof(block) };
+constexpr uint32_t block_mask{ (1u << block_size) - 1u };
+
+[[nodiscard]] auto load(const char *data) noexcept -> block {
+	return _mm_loadu_si128(reinterpret_cast<const block *>(data));
+}
+[[nodiscard]] auto bits_of(const block bytes) noexcept -> uint32_t {
+	return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+}
+[[nodiscard]] auto equal(const block bytes, const char symbol) noexcept -> block {
+	return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(symbol));
+}
+/// The comparison is signed, so the bytes above 0x7F are never in the range
+[[nodiscard]] auto in_range(const block bytes, const char from, const char to) noexcept -> block {
+	return _mm_and_si128(
+		_mm_cmpgt_epi8(bytes, _mm_set1_epi8(static_cast<char>(from - 1))),
+		_mm_cmplt_epi8(bytes, _mm_set1_epi8(static_cast<char>(to + 1)))
+	);
+}
+
+[[nodiscard]] auto spaces_of(const block bytes) noexcept -> uint32_t {
+	return bits_of(_mm_or_si128(equal(bytes, ' '), in_range(bytes, '\t', '\r')));
+}
+[[nodiscard]] auto identifiers_of(const block bytes) noexcept -> uint32_t {
+	const auto lower{ _mm_or_si128(bytes, _mm_set1_epi8(0x20)) };
+	return bits_of(_mm_or_si128(
+		_mm_or_si128(in_range(bytes, '0', '9'), in_range(lower, 'a', 'z')),
+		equal(bytes, '_')
+	));
+}
+
+#endif // defined(LOX_CHARSCAN_SSE2)
+
+/**
+ * Moves forward till the first stop byte. `stops` makes the bit mask of
+ * the stop bytes of the block starting at the pointer, `is_stop` checks
+ * the single byte of the tail.
+ */
+template<bool CountLines, class Stops, class IsStop>
+auto scan(const std::string_view text, size_t pos, [[maybe_unused]] Stops stops, IsStop is_stop) noexcept -> scan_result {
+	const auto data{ std::data(text) };
+	const auto size{ std::size(text) };
+	uint32_t new_lines{};
+
+#if defined(LOX_CHARSCAN_SSE2)
+	for (; pos + block_size <= size; pos += block_size) {
+		const auto found{ stops(data + pos) };
+		[[maybe_unused]] uint32_t lines{};
+		if constexpr (CountLines) {
+			lines = bits_of(equal(load(data + pos), '\n'));
+		}
+
+		if (found != 0u) {
+			const auto offset{ static_cast<uint32_t>(std::countr_zero(found)) };
+			if constexpr (CountLines) {
+				new_lines += static_cast<uint32_t>(std::popcount(lines & ((1u << offset) - 1u)));
+			}
+			return scan_result{ pos + offset, new_lines };
+		}
+		if constexpr (CountLines) {
+			new_lines += static_cast<uint32_t>(std::popcount(lines));
+		}
+	}
+#endif // defined(LOX_CHARSCAN_SSE2)
+
+	for (; pos < size && !is_stop(data + pos); ++pos) {
+		if constexpr (CountLines) {
+			new_lines += static_cast<uint32_t>(data[pos] == '\n');
+		}
+	}
+	return scan_result{ pos, new_lines };
+}
+
+} // namespace
+
+#if defined(LOX_CHARSCAN_SSE2)
+#define LOX_CHARSCAN_STOPS(...) [](const char *at) noexcept -> uint32_t { return __VA_ARGS__; }
+#else
+#define LOX_CHARSCAN_STOPS(...) nullptr
+#endif // defined(LOX_CHARSCAN_SSE2)
+
+auto skip_spaces(const std::string_view text, const size_t from) noexcept -> scan_result {
+	return scan<true>(text, from,
+		LOX_CHARSCAN_STOPS(~spaces_of(load(at)) & block_mask),
+		[](const char *at) { return !char_class::is(*at, char_class::space); }
+	);
+}
+
+auto skip_identifier(const std::string_view text, const size_t from) noexcept -> size_t {
+	return scan<false>(text, from,
+		LOX_CHARSCAN_STOPS(~identifiers_of(load(at)) & block_mask),
+		[](const char *at) { return !char_class::is(*at, char_class::identifier); }
+	).position;
+}
+
+auto find(const std::string_view text, const size_t from, const char symbol) noexcept -> scan_result {
+#if defined(LOX_CHARSCAN_SSE2)
+	const auto stops{ [needle{ _mm_set1_epi8(symbol) }](const char *at) noexcept -> uint32_t {
+		return bits_of(_mm_cmpeq_epi8(load(at), needle));
+	} };
+#else
+	constexpr auto stops{ nullptr };
+#endif // defined(LOX_CHARSCAN_SSE2)
+
+	return scan<true>(text, from, stops, [symbol](const char *at) { return *at == symbol; });
+}
+
+auto find_comment_end(const std::string_view text, const size_t from) noexcept -> scan_result {
+	return scan<true>(text, from,
+		LOX_CHARSCAN_STOPS(bits_of(_mm_or_si128(equal(load(at), '/'), equal(load(at - 1), '*')))),
+		[](const char *at) { return at[0] == '/' || at[-1] == '*'; }
+	);
+}
+
+#undef LOX_CHARSCAN_STOPS
+
+} // namespace lox::utils::charscan
@@ -1,35 +1,83 @@
 #include <cstdio>
-#include <array>
-#include <vector>
+#include <span>
 #include <string>
+#include <vector>
 #include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 #include "lox/types/native_functions.hpp"
+#include "lox/source_file.hpp"
+#include "lox/front_end.hpp"
+#include "lox/program_cache.hpp"
 #include "lox/scanner.hpp"
 #include "lox/parser.hpp"
-#include "lox/execution/interpreter.hpp"
+#include "lox/execution/engine.hpp"
+#include "lox/execution/constant_folder.hpp"
+#include "lox/execution/resolver.hpp"
 #include "lox/utils/exit_codes.hpp"
 
 void print_literal(const lox::literal &lit) {
 	std::printf(" %s", std::data(lox::to_string(lit)));
 }
 
-auto evaluate(const std::string_view file_path, const std::string_view script) -> lox::utils::exit_codes {
+void report(const std::string_view title, lox::error_handler &errout) {
+	if (std::empty(errout)) return;
+
+	std::printf("%.*s\n", static_cast<int32_t>(std::size(title)), std::data(title));
+	errout.export_records([](std::string_view err) {
+		std::printf("%.*s\n", static_cast<int32_t>(std::size(err)), std::data(err));
+	});
+	errout.clear();
+}
+
+auto execute(
+	lox::program &program,
+	lox::lexeme_database &lexemes,
+	lox::error_handler &errout,
+	lox::execution::engine engine
+) -> lox::utils::exit_codes {
+	std::printf("\n----------------------- EXECUTION -----------------------\n\n");
+
+	lox::execution::environment env{};
+	lox::native::add_native_functions(lexemes, env);
+
+	lox::execution::constant_folder{ program, env }.fold();
+	lox::execution::resolver{ program, env }.resolve();
+
+	const auto status{ lox::execution::run(engine, std::move(env), program, lexemes, errout) };
+	if (status != lox::execution::status::ok || !std::empty(errout)) {
+		report("Runtime Errors:", errout);
+		return lox::utils::exit_codes::software;
+	}
+
+	return lox::utils::exit_codes::ok;
+}
+
+/// The script is cached when the cache path is given and it's parsed without errors
+auto evaluate(
+	const std::string_view file_path,
+	const std::string_view script,
+	lox::execution::engine engine,
+	const std::string &cache = {}
+) -> lox::utils::exit_codes {
 	lox::error_handler errout{ std::string{ file_path }, script };
 
+	if (!std::empty(cache)) {
+		if (auto cached{ lox::load_cache(cache, script) }; cached.has_value()) {
+			errout.set_line_index(cached->lines);
+			return execute(cached->prog, cached->lexemes, errout, engine);
+		}
+	}
+
 	lox::scanner scanner{ script, errout };
 
 	// std::printf("\n------------------------ SCANNING -----------------------\n\n");
-	auto ctx{ scanner.scan() };
-
-	if (!std::empty(errout)) {
-		std::printf("Scan Errors:\n");
-		errout.export_records([](std::string_view err) {
-			std::printf("%.*s\n", static_cast<int32_t>(std::size(err)), std::data(err));
-		});
-		errout.clear();
-	}
+	auto ctx{ scanner.scan_parallel() };
+	errout.set_line_index(ctx.lines);
+
+	bool cacheable{ std::empty(errout) };
+	report("Scan Errors:", errout);
 
 	// std::printf("\nLiterals:\n");
 	// for (size_t i{}; i < std::size(ctx.literals); ++i) {
@@ -41,97 +89,116 @@ auto evaluate(const std::string_view file_path, const std::string_view script) -
 	// std::printf("\n------------------------ PARSING ------------------------\n\n");
 
 	lox::parser parser{ ctx, errout };
-	auto program{ parser.parse() };
-
-	if (!std::empty(errout)) {
-		std::printf("Parse Errors:\n");
-		errout.export_records([](std::string_view err) {
-			std::printf("%.*s\n", static_cast<int32_t>(std::size(err)), std::data(err));
-		});
-		errout.clear();
-	}
+	auto program{ parser.parse_parallel() };
+	program.relayout();
 
-	std::printf("\n----------------------- EXECUTION -----------------------\n\n");
+	cacheable = cacheable && std::empty(errout);
+	report("Parse Errors:", errout);
 
-	lox::execution::environment env{};
-	lox::native::add_native_functions(ctx.lexemes, env);
-
-	lox::execution::interpreter interpreter{ std::move(env), program, ctx.lexemes, errout };
-
-	if (const auto status{ interpreter.run() }; status != lox::execution::status::ok || !std::empty(errout)) {
-		std::printf("Runtime Errors:\n");
-		errout.export_records([](std::string_view err) {
-			std::printf("%.*s\n", static_cast<int32_t>(std::size(err)), std::data(err));
-		});
-		errout.clear();
-
-		return lox::utils::exit_codes::software;
+	if (!std::empty(cache) && cacheable) {
+		lox::store_cache(cache, script, program, ctx.lexemes, ctx.lines);
 	}
 
-	return lox::utils::exit_codes::ok;
+	return execute(program, ctx.lexemes, errout, engine);
 }
 
-auto run_file(const std::string_view path) -> lox::utils::exit_codes;
-auto run_prompt() -> lox::utils::exit_codes;
+auto run_file(const std::string_view path, lox::execution::engine engine, bool cache) -> lox::utils::exit_codes;
+auto run_files(std::span<const char *> paths, lox::execution::engine engine) -> lox::utils::exit_codes;
+auto run_prompt(lox::execution::engine engine) -> lox::utils::exit_codes;
+auto usage(const std::string_view executable) -> lox::utils::exit_codes;
 
 int main(const int argc, const char *argv[]) {
 	using lox::utils::as_int;
-
-	if (argc > 2) {
-		const std::string_view executable{ argv[0] };
-		const auto file_name{ executable.substr(executable.find_last_of("/\\") + 1) };
-		std::printf("Usage: %.*s [script]",
-			static_cast<int32_t>(std::size(file_name)),
-			std::data(file_name)
-		);
-		return as_int(lox::utils::exit_codes::usage);
+	using namespace std::string_view_literals;
+
+	constexpr auto engine_option{ "--engine="sv };
+	constexpr auto cache_option{ "--cache"sv };
+
+	auto engine{ lox::execution::engine::tree_walker };
+	bool cache{ false };
+	std::span<const char *> args{ std::next(argv), static_cast<size_t>(argc - 1) };
+
+	for (; !std::empty(args) && std::string_view{ args.front() }.starts_with("--"); args = args.subspan(1)) {
+		const std::string_view option{ args.front() };
+		if (option == cache_option) {
+			cache = true;
+			continue;
+		}
+		if (!option.starts_with(engine_option)) {
+			return as_int(usage(argv[0]));
+		}
+
+		const auto parsed{ lox::execution::to_engine(option.substr(std::size(engine_option))) };
+		if (!parsed.has_value()) {
+			return as_int(usage(argv[0]));
+		}
+		engine = *parsed;
 	}
 
-	if (argc == 2) {
-		return as_int(run_file(argv[1]));
+	/// A script too large for the ids of the program can't be parsed at all
+	try {
+		if (std::size(args) > 1) {
+			return as_int(run_files(args, engine));
+		}
+
+		if (std::size(args) == 1) {
+			return as_int(run_file(args.front(), engine, cache));
+		}
+		return as_int(run_prompt(engine));
+	} catch (const std::length_error &error) {
+		std::printf("%s\n", error.what());
+		return as_int(lox::utils::exit_codes::dataerr);
 	}
-	return as_int(run_prompt());
 }
 
-auto run_file(const std::string_view path) -> lox::utils::exit_codes {
-	auto file{ std::fopen(std::data(path), "r") };
-	if (file == nullptr) {
-		std::printf(R"(Failed to open "%s" file: %s)", std::data(path), std::strerror(errno));
-		return lox::utils::exit_codes::ioerr;
-	}
+auto usage(const std::string_view executable) -> lox::utils::exit_codes {
+	const auto file_name{ executable.substr(executable.find_last_of("/\\") + 1) };
+	std::printf("Usage: %.*s [--engine=tree|vm] [--cache] [script...]",
+		static_cast<int32_t>(std::size(file_name)),
+		std::data(file_name)
+	);
+	return lox::utils::exit_codes::usage;
+}
 
-	if (std::fseek(file, 0, SEEK_END)) {
-		std::printf(R"(Failed to seek file "%s": %s)", std::data(path), std::strerror(errno));
-		std::fclose(file);
+/// The script is cached in $LOX_CACHE_DIR, or next to it when the cache is asked for on the command line
+auto run_file(const std::string_view path, lox::execution::engine engine, bool cache) -> lox::utils::exit_codes {
+	/// The mapping has to outlive the evaluation, the scanner and the errors refer to it
+	const auto file{ lox::source_file::open(std::string{ path }) };
+	if (!file.has_value()) {
+		std::printf("%s", std::data(file.error()));
 		return lox::utils::exit_codes::ioerr;
 	}
-	const auto length{ std::ftell(file) };
-	if (length == -1) {
-		std::printf(R"(Failed to read file "%s": %s)", std::data(path), std::strerror(errno));
-		std::fclose(file);
+
+	return evaluate(file->path(), file->view(), engine, lox::cache_path(path, cache));
+}
+
+/// The scripts are scanned and parsed together, then executed one by one in the given order
+auto run_files(std::span<const char *> paths, lox::execution::engine engine) -> lox::utils::exit_codes {
+	const std::vector<std::string> files{ std::begin(paths), std::end(paths) };
+	auto project{ lox::parse_files(files) };
+	if (!project.has_value()) {
+		std::printf("%s", std::data(project.error()));
 		return lox::utils::exit_codes::ioerr;
 	}
 
-	std::fseek(file, 0, SEEK_SET);
+	auto exit_code{ lox::utils::exit_codes::ok };
+	for (const auto &unit : project->units) {
+		report("Scan Errors:", unit->scan_errors);
+		report("Parse Errors:", unit->parse_errors);
 
-	if (constexpr long stack_buffer_size{ 256 }; length < stack_buffer_size) {
-		std::array<char, stack_buffer_size> buffer{};
-		const auto read_bytes{ std::fread(std::data(buffer), sizeof(char), length, file) };
-		std::fclose(file);
-		return evaluate(path, std::string_view{ std::data(buffer), read_bytes });
+		if (execute(unit->prog, project->lexemes, unit->parse_errors, engine) != lox::utils::exit_codes::ok) {
+			exit_code = lox::utils::exit_codes::software;
+		}
 	}
 
-	std::vector<char> buffer(static_cast<size_t>(length));
-	const auto read_bytes{ std::fread(std::data(buffer), sizeof(char), length, file) };
-	std::fclose(file);
-	return evaluate(path, std::string_view{ std::data(buffer), read_bytes });
+	return exit_code;
 }
 
-auto run_prompt() -> lox::utils::exit_codes {
+auto run_prompt(lox::execution::engine engine) -> lox::utils::exit_codes {
 	std::printf("Lox 1.0.0\n> ");
 
 	for (std::string line{}; std::getline(std::cin, line); std::printf("> ")) {
-		const auto exit_code{ evaluate("console", line) };
+		const auto exit_code{ evaluate("console", line, engine) };
 		std::printf("Result %X: %s\n", static_cast<uint32_t>(exit_code), std::data(exit_codes_name(exit_code)));
 	}
 
@@ -0,0 +1,7 @@
+# The scripts which measure their time print it, so it's masked before the outputs are compared.
+# include(durations.cmake), then mask_durations(<output variable>)
+
+function(mask_durations output)
+	string(REGEX REPLACE "Execution time: [0-9]+ ms" "Execution time: ? ms" masked "${${output}}")
+	set(${output} "${masked}" PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,29 @@
+# Runs the script by the tree walker and by the virtual machine, the outputs have to be the same.
+# cmake -Dilox=<interpreter> -Dscript=<script.lox> -P engine_parity.cmake
+
+if(NOT ilox OR NOT script)
+	message(FATAL_ERROR "Usage: cmake -Dilox=<interpreter> -Dscript=<script.lox> -P engine_parity.cmake")
+endif()
+
+include(${CMAKE_CURRENT_LIST_DIR}/durations.cmake)
+
+# Nothing is read from the cache or left next to the asset
+unset(ENV{LOX_CACHE_DIR})
+
+foreach(engine IN ITEMS tree vm)
+	execute_process(COMMAND ${ilox} --engine=${engine} ${script}
+		OUTPUT_VARIABLE output_${engine}
+		ERROR_VARIABLE output_${engine}
+		RESULT_VARIABLE result_${engine}
+		TIMEOUT 60
+	)
+	mask_durations(output_${engine})
+endforeach()
+
+if(NOT result_tree STREQUAL result_vm)
+	message(FATAL_ERROR "The tree walker exited with ${result_tree}, the virtual machine with ${result_vm}")
+endif()
+
+if(NOT output_tree STREQUAL output_vm)
+	message(FATAL_ERROR "The outputs differ.\n--- tree ---\n${output_tree}\n--- vm ---\n${output_vm}")
+endif()
@@ -0,0 +1,58 @@
+# Runs all the scripts of the directory together, so they share the lexemes, and then one by one.
+# The outputs have to be the same, in the order of the names and in the reversed one.
+# cmake -Dilox=<interpreter> -Dengine=<tree|vm> -Ddirectory=<assets> -P multiple_files.cmake
+
+if(NOT ilox OR NOT engine OR NOT directory)
+	message(FATAL_ERROR "Usage: cmake -Dilox=<interpreter> -Dengine=<tree|vm> -Ddirectory=<assets> -P multiple_files.cmake")
+endif()
+
+include(${CMAKE_CURRENT_LIST_DIR}/durations.cmake)
+
+# Nothing is read from the cache or left next to the assets
+unset(ENV{LOX_CACHE_DIR})
+
+file(GLOB scripts ${directory}/*.lox)
+list(LENGTH scripts count)
+if(count LESS 2)
+	message(FATAL_ERROR "At least two scripts are needed in ${directory}, found ${count}")
+endif()
+
+function(check_order)
+	execute_process(COMMAND ${ilox} --engine=${engine} ${scripts}
+		OUTPUT_VARIABLE output_together
+		ERROR_VARIABLE output_together
+		RESULT_VARIABLE result_together
+		TIMEOUT 120
+	)
+
+	# Every failed script fails the whole run with the same code
+	set(output_alone "")
+	set(result_alone 0)
+	foreach(script IN LISTS scripts)
+		execute_process(COMMAND ${ilox} --engine=${engine} ${script}
+			OUTPUT_VARIABLE output
+			ERROR_VARIABLE output
+			RESULT_VARIABLE result
+			TIMEOUT 60
+		)
+		string(APPEND output_alone "${output}")
+		if(NOT result EQUAL 0)
+			set(result_alone ${result})
+		endif()
+	endforeach()
+
+	mask_durations(output_together)
+	mask_durations(output_alone)
+
+	if(NOT result_together STREQUAL result_alone)
+		message(FATAL_ERROR "The scripts together exited with ${result_together}, one by one with ${result_alone}")
+	endif()
+
+	if(NOT output_together STREQUAL output_alone)
+		message(FATAL_ERROR "The outputs differ.\n--- together ---\n${output_together}\n--- one by one ---\n${output_alone}")
+	endif()
+endfunction()
+
+check_order()
+list(REVERSE scripts)
+check_order()
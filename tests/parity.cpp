@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <format>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <string_view>
+
+#include "lox/constants.hpp"
+#include "lox/source_file.hpp"
+#include "lox/scanner.hpp"
+#include "lox/parser.hpp"
+#include "lox/utils/strutils.hpp"
+
+/**
+ * Checks that scan_parallel() and parse_parallel() give the same output as scan() and parse(),
+ * and so do next() and the parser over the scanner when the script is read by chunks.
+ * Every script is checked as it is and repeated till it's large enough to be split into chunks.
+ *
+ * Usage: lox-parity <script.lox>...
+ */
+
+namespace {
+
+/// The parallel paths don't split the scripts smaller than that
+constexpr size_t repeated_size{ 4u * lox::constants::parallel_scan_min_chunk };
+constexpr size_t jobs{ 4u };
+/// Odd enough to split the tokens, so the scanner has to read on in the middle of them
+constexpr size_t small_chunk{ 61u };
+
+void fail(const std::string_view path, const std::string_view message) {
+	std::printf("FAIL %.*s: %.*s\n",
+		static_cast<int32_t>(std::size(path)), std::data(path),
+		static_cast<int32_t>(std::size(message)), std::data(message)
+	);
+}
+
+auto errors_of(const lox::error_handler &errout) -> std::vector<std::string> {
+	std::vector<std::string> errors{};
+	errout.export_records([&errors](std::string_view err) { errors.emplace_back(err); });
+	return errors;
+}
+
+/// The lexemes and the literals are compared by their values, the ids depend on the order they're met
+auto same_token(const lox::context &lhs, const lox::token &ltok, const lox::context &rhs, const lox::token &rtok) -> bool {
+	if (ltok.type != rtok.type || ltok.line != rtok.line || ltok.position != rtok.position) {
+		return false;
+	}
+	if (ltok.type == lox::token_type::identifier) {
+		return lhs.lexemes.get(ltok.lexeme_id) == rhs.lexemes.get(rtok.lexeme_id);
+	}
+	if (ltok.literal_id == lox::invalid_id || rtok.literal_id == lox::invalid_id) {
+		return ltok.literal_id == rtok.literal_id;
+	}
+	return lhs.literals.at(ltok.literal_id) == rhs.literals.at(rtok.literal_id);
+}
+
+auto same_tokens(const lox::context &lhs, const lox::context &rhs) -> bool {
+	if (std::size(lhs.tokens) != std::size(rhs.tokens) || lhs.lines != rhs.lines) {
+		return false;
+	}
+	for (size_t i{}; i < std::size(lhs.tokens); ++i) {
+		if (!same_token(lhs, lhs.tokens[i], rhs, rhs.tokens[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Gives the script by small pieces
+auto string_reader(const std::string_view script) -> lox::scanner::chunk_reader {
+	return [script, offset = size_t{}](std::span<char> chunk) mutable -> size_t {
+		const auto piece{ script.substr(offset, (std::min)(std::size(chunk), small_chunk)) };
+		std::ranges::copy(piece, std::begin(chunk));
+		offset += std::size(piece);
+		return std::size(piece);
+	};
+}
+
+/// Puts the script into a temporary file, so it's read through a real descriptor
+auto temporary_file(const std::string_view script) -> std::unique_ptr<std::FILE, decltype(&std::fclose)> {
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> file{ std::tmpfile(), &std::fclose };
+	if (file == nullptr) return file;
+
+	std::fwrite(std::data(script), sizeof(char), std::size(script), file.get());
+	std::fflush(file.get());
+	std::rewind(file.get());
+	return file;
+}
+
+auto descriptor_of(std::FILE *file) -> int {
+#if defined(_WIN32)
+	return ::_fileno(file);
+#else
+	return ::fileno(file);
+#endif
+}
+
+/**
+ * The end_of_file token of a stream points at the real end of the source instead of the end of the stripped one,
+ * since the trailing whitespaces can't be stripped ahead. The positions start after the leading ones in both.
+ */
+auto same_end(const lox::token &scanned, const lox::token &streamed, const std::string_view script) -> bool {
+	const auto leading{ (std::min)(script.find_first_not_of(lox::utils::whitespaces), std::size(script)) };
+	return streamed.type == lox::token_type::end_of_file && scanned.line <= streamed.line
+		&& streamed.position == std::size(script) - leading;
+}
+
+/// The source is read by chunks from the reader, which is made anew for every pass.
+/// The scan and the parse errors come interleaved, so they're compared regardless of the order
+auto check_stream(const std::string &path, const std::string_view script, const std::string_view reader,
+	const lox::context &scanned, const lox::program &parsed, const std::vector<std::string> &errors,
+	const std::function<lox::scanner::chunk_reader()> &make_reader
+) -> bool {
+	bool passed{ true };
+
+	lox::error_handler stream_errors{ path, script };
+	lox::scanner stream{ make_reader(), stream_errors };
+	size_t count{};
+	for (auto tok{ stream.next() }; tok.type != lox::token_type::end_of_file; tok = stream.next(), ++count) {
+		if (count + 1u >= std::size(scanned.tokens) || !same_token(scanned, scanned.tokens[count], stream.streamed(), tok)) {
+			fail(path, std::format("next() by {} differs from scan() at the token {}", reader, count));
+			return false;
+		}
+	}
+	if (count + 1u != std::size(scanned.tokens) || !same_end(scanned.tokens.back(), stream.next(), script)) {
+		fail(path, std::format("next() by {} ends not where scan() does", reader));
+		passed = false;
+	}
+
+	lox::error_handler parse_errors{ path, script };
+	lox::scanner parsed_stream{ make_reader(), parse_errors };
+	auto streamed{ lox::parser{ parsed_stream, parse_errors }.parse() };
+	streamed.relayout();
+	auto streamed_errors{ errors_of(parse_errors) };
+	std::ranges::sort(streamed_errors);
+	if (!(streamed == parsed) || streamed_errors != errors) {
+		fail(path, std::format("the parser over the scanner by {} differs from parse()", reader));
+		passed = false;
+	}
+	return passed;
+}
+
+auto check(const std::string &path, const std::string_view script) -> bool {
+	lox::error_handler scan_errors{ path, script };
+	lox::error_handler parallel_scan_errors{ path, script };
+	const auto scanned{ lox::scanner{ script, scan_errors }.scan() };
+	const auto scanned_parallel{ lox::scanner{ script, parallel_scan_errors }.scan_parallel(jobs) };
+
+	bool passed{ true };
+	if (scanned.lines != lox::make_line_index(script)) {
+		fail(path, "the lines indexed by scan() differ from make_line_index()");
+		passed = false;
+	}
+	if (!same_tokens(scanned, scanned_parallel) || errors_of(scan_errors) != errors_of(parallel_scan_errors)) {
+		fail(path, "scan_parallel() differs from scan()");
+		passed = false;
+	}
+
+	/// Both parsers take the same tokens, so the lexeme and the literal ids of the nodes match too
+	lox::error_handler parse_errors{ path, script };
+	lox::error_handler parallel_parse_errors{ path, script };
+	auto parsed{ lox::parser{ scanned, parse_errors }.parse() };
+	auto parsed_parallel{ lox::parser{ scanned, parallel_parse_errors }.parse_parallel(jobs) };
+	parsed.relayout();
+	parsed_parallel.relayout();
+
+	if (!(parsed == parsed_parallel) || errors_of(parse_errors) != errors_of(parallel_parse_errors)) {
+		fail(path, "parse_parallel() differs from parse()");
+		passed = false;
+	}
+
+	auto errors{ errors_of(scan_errors) };
+	std::ranges::copy(errors_of(parse_errors), std::back_inserter(errors));
+	std::ranges::sort(errors);
+
+	passed = check_stream(path, script, "small chunks", scanned, parsed, errors, [script] {
+		return string_reader(script);
+	}) && passed;
+
+	const auto file{ temporary_file(script) };
+	if (file == nullptr) {
+		fail(path, "no temporary file for the descriptor reader");
+		return false;
+	}
+	return check_stream(path, script, "descriptor", scanned, parsed, errors, [&file] {
+		std::rewind(file.get());
+		return lox::scanner::descriptor_reader(descriptor_of(file.get()));
+	}) && passed;
+}
+
+auto repeat(const std::string_view script) -> std::string {
+	std::string repeated{};
+	if (std::empty(script)) return repeated;
+
+	repeated.reserve(repeated_size + std::size(script) + 1u);
+	while (std::size(repeated) < repeated_size) {
+		repeated.append(script);
+		repeated.push_back('\n');
+	}
+	return repeated;
+}
+
+} // namespace
+
+int main(const int argc, const char *argv[]) {
+	const std::span<const char *> paths{ std::next(argv), static_cast<size_t>(argc - 1) };
+	if (std::empty(paths)) {
+		std::printf("Usage: lox-parity <script.lox>...\n");
+		return EXIT_FAILURE;
+	}
+
+	bool passed{ true };
+	for (const std::string path : paths) {
+		const auto file{ lox::source_file::open(path) };
+		if (!file.has_value()) {
+			fail(path, file.error());
+			passed = false;
+			continue;
+		}
+
+		passed = check(path, file->view()) && passed;
+		passed = check(path + " (repeated)", repeat(file->view())) && passed;
+	}
+
+	std::printf("%s\n", passed ? "OK" : "FAILED");
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
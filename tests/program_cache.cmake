@@ -0,0 +1,84 @@
+# Runs the script cold and warm from the cache, then from a truncated and a corrupted cache.
+# Every run has to print the same, a damaged cache has to be dropped and written anew from the script.
+# cmake -Dilox=<interpreter> -Dscript=<script.lox> -Dcache_dir=<directory> -P program_cache.cmake
+
+if(NOT ilox OR NOT script OR NOT cache_dir)
+	message(FATAL_ERROR "Usage: cmake -Dilox=<interpreter> -Dscript=<script.lox> -Dcache_dir=<directory> -P program_cache.cmake")
+endif()
+
+include(${CMAKE_CURRENT_LIST_DIR}/durations.cmake)
+
+file(REMOVE_RECURSE ${cache_dir})
+file(MAKE_DIRECTORY ${cache_dir})
+set(ENV{LOX_CACHE_DIR} ${cache_dir})
+
+function(run_script run)
+	execute_process(COMMAND ${ilox} ${script}
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE output
+		RESULT_VARIABLE result
+		TIMEOUT 60
+	)
+	mask_durations(output)
+	set(output_${run} "${output}" PARENT_SCOPE)
+	set(result_${run} "${result}" PARENT_SCOPE)
+endfunction()
+
+function(expect_same_run run)
+	if(NOT result_${run} STREQUAL result_cold)
+		message(FATAL_ERROR "The cold run exited with ${result_cold}, the ${run} run with ${result_${run}}")
+	endif()
+	if(NOT output_${run} STREQUAL output_cold)
+		message(FATAL_ERROR "The outputs differ.\n--- cold ---\n${output_cold}\n--- ${run} ---\n${output_${run}}")
+	endif()
+endfunction()
+
+# The records are written with their padding bytes, so the rewritten file is compared by its size
+# and by the run which reads it
+function(expect_rewritten run)
+	file(SIZE ${pristine} expected_size)
+	file(SIZE ${cache} size)
+	if(NOT size EQUAL expected_size)
+		message(FATAL_ERROR "The ${run} cache wasn't replaced by the one parsed from the script")
+	endif()
+
+	run_script(rewritten)
+	expect_same_run(rewritten)
+endfunction()
+
+run_script(cold)
+
+# The scripts with errors aren't cached
+file(GLOB caches ${cache_dir}/*.loxc)
+list(LENGTH caches count)
+if(count EQUAL 0)
+	return()
+endif()
+if(NOT count EQUAL 1)
+	message(FATAL_ERROR "Expected one cache in ${cache_dir}, found ${count}")
+endif()
+
+file(GLOB leftovers ${cache_dir}/*.tmp*)
+if(leftovers)
+	message(FATAL_ERROR "The temporary files were left behind: ${leftovers}")
+endif()
+
+set(cache ${caches})
+set(pristine ${cache_dir}/pristine.loxc.bak)
+file(COPY_FILE ${cache} ${pristine})
+
+run_script(warm)
+expect_same_run(warm)
+
+# The file ends right after the tag of the header
+file(WRITE ${cache} "LOXC")
+run_script(truncated)
+expect_same_run(truncated)
+expect_rewritten(truncated)
+
+# The header is intact, the payload doesn't match its checksum anymore
+file(COPY_FILE ${pristine} ${cache})
+file(APPEND ${cache} "damaged")
+run_script(corrupted)
+expect_same_run(corrupted)
+expect_rewritten(corrupted)
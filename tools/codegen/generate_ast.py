@@ -33,6 +33,23 @@ def generate_base_class(file: TextIOWrapper, base_class: str, classes: dict[str,
 
 	file.write('};\n\n')
 
+def generate_static_visitor_concept(file: TextIOWrapper, base_class: str, classes: dict[str, str]) -> None:
+	file.write('/// Any class with the accept methods. The program calls them directly, without the virtual dispatch\n')
+	file.write('template<class Visitor>\n')
+	file.write(f'concept {base_class}_visitor = requires(Visitor &visitor) {{\n')
+	for cls in classes:
+		(conditions, class_name) = utils.split_conditions_and_class_name(cls)
+		utils.open_conditions(conditions, file)
+		file.write(f'\tvisitor.accept(std::declval<const {base_class}<{base_class}_type::{class_name}> &>());\n')
+		utils.close_conditions(conditions, file)
+	file.write('};\n\n')
+
+	(_, first_class) = utils.split_conditions_and_class_name(next(iter(classes)))
+	file.write(f'template<{base_class}_visitor Visitor>\n')
+	file.write(f'using {base_class}_visitor_output_t = decltype(\n')
+	file.write(f'\tstd::declval<Visitor &>().accept(std::declval<const {base_class}<{base_class}_type::{first_class}> &>())\n')
+	file.write(');\n\n')
+
 def generate_derived_class_definition(file: TextIOWrapper, base_class: str, cls_name: str, fields: str) -> None:
 	(conditions, class_name) = utils.split_conditions_and_class_name(cls_name)
 	enum_name: str = f'{base_class}_type'
@@ -48,6 +65,7 @@ def generate_derived_class_definition(file: TextIOWrapper, base_class: str, cls_
 
 	for field in fields.split(','):
 		file.write(f'\t{field.strip()}{{}};\n')
+	file.write(f'\n\t[[nodiscard]] auto operator==(const {base_class} &other) const -> bool = default;\n')
 
 	# file.write(f'\t[[nodiscard]] static auto type() noexcept -> {enum_name} {{ return {enum_name}::{class_name}; }}\n')
 	file.write('};\n')
@@ -55,21 +73,27 @@ def generate_derived_class_definition(file: TextIOWrapper, base_class: str, cls_
 
 	utils.close_conditions(conditions, file)
 
-def define_ast(out_dir: str, includes: list[str], base_class: str, classes: dict[str, str]) -> str:
+def define_ast(out_dir: str, includes: list[str], base_class: str, classes: dict[str, str], static_visitors: bool) -> str:
 	header_file_path: str = os.path.join(out_dir, constants.INCLUDE_DIR, base_class + '.hpp').replace('\\', '/')
 	include_path: str = utils.make_include_path(base_class)
 
 	with open(header_file_path, 'w+') as header:
 		header.write(constants.DISCLAIMER.format(generator_filename = utils.get_filename(__file__)))
 		header.write(constants.HEADER_BEGIN)
+		if static_visitors:
+			header.write('\n#include <utility>')
 		for include in includes:
 			header.write(f'\n#include {include}')
 
 		header.write(constants.OPEN_NAMESPACE)
 
 		generate_types_enum(header, base_class, classes)
-		header.write(f'using {base_class}_id = ID<{base_class}_type>;\n\n')
+		header.write(f'using {base_class}_id = ID<{base_class}_type>;\n')
+		header.write(f'static_assert({len(classes)}u <= (1u << {base_class}_id::type_bits), "The {base_class} types have to fit into the id");\n')
+		header.write(f'static_assert(sizeof({base_class}_id) == sizeof({base_class}_id::index_type), "The type has to share the bits of the index");\n\n')
 		generate_base_class(header, base_class, classes)
+		if static_visitors:
+			generate_static_visitor_concept(header, base_class, classes)
 
 		for (cls, fields) in classes.items():
 			header.write('\n')
@@ -86,8 +110,12 @@ def main(args: Namespace) -> int:
 
 	config = configuration(args.config)
 
-	include: str = define_ast(output_path, config.expression_includes, config.expression_class, config.expressions)
-	define_ast(output_path, config.statement_includes + [include], config.statement_class, config.statements)
+	include: str = define_ast(output_path, config.expression_includes,
+		config.expression_class, config.expressions, args.static_visitors
+	)
+	define_ast(output_path, config.statement_includes + [include],
+		config.statement_class, config.statements, args.static_visitors
+	)
 
 	return 0
 
@@ -98,4 +126,7 @@ if __name__ == '__main__':
 	)
 	parser.add_argument('--output', type=str, help='The path to output directory')
 	parser.add_argument('--config', type=str, help='The path to the generation info JSON file')
+	parser.add_argument('--static-visitors', action='store_true',
+		help='Generate the visitor concepts for the calls without the virtual dispatch'
+	)
 	exit(main(parser.parse_args()))
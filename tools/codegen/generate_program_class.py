@@ -6,6 +6,7 @@ from io import TextIOWrapper
 from argparse import ArgumentParser, Namespace
 
 CLASS_NAME: str = 'program_base'
+POOL_KINDS: tuple[str, str] = ('pool_range', 'pool_id')
 
 DEFAULT_RULE_OF_FIVE: str = '''
 	{class_name}() = default;
@@ -39,6 +40,7 @@ def define_records_struct(file: TextIOWrapper, base_class: str, types: dict[str,
 		file.write(f'\tstd::vector<{type}> {class_name}s{{}};\n')
 		utils.close_conditions(conditions, file)
 
+	file.write(f'\n\t[[nodiscard]] auto operator==(const {name} &other) const -> bool = default;\n')
 	file.write('};\n\n')
 	return name
 
@@ -64,7 +66,7 @@ def define_get_instantiations(file: TextIOWrapper, base_class: str, type_name: s
 def define_get_with_id(file: TextIOWrapper, type_name: str):
 	file.write(f'\ttemplate<{type_name}_type Type>\n')
 	file.write(f'\t[[nodiscard]] decltype(auto) get_{type_name}s(ID<decltype(Type)> id) const {{\n')
-	file.write('\t\tif (id.type == Type) {\n')
+	file.write('\t\tif (id.type() == Type) {\n')
 	file.write(f'\t\t\treturn get_{type_name}s<Type>().at(id.index);\n')
 	file.write('\t\t}\n\n')
 	file.write('\t\tthrow std::invalid_argument{ "Invalid type id" };\n')
@@ -72,7 +74,7 @@ def define_get_with_id(file: TextIOWrapper, type_name: str):
 
 	file.write(f'\ttemplate<{type_name}_type Type>\n')
 	file.write(f'\t[[nodiscard]] decltype(auto) get_{type_name}s(ID<decltype(Type)> id) {{\n')
-	file.write('\t\tif (id.type == Type) {\n')
+	file.write('\t\tif (id.type() == Type) {\n')
 	file.write(f'\t\t\treturn get_{type_name}s<Type>().at(id.index);\n')
 	file.write('\t\t}\n\n')
 	file.write('\t\tthrow std::invalid_argument{ "Invalid type id" };\n')
@@ -82,7 +84,16 @@ def define_get_with_id(file: TextIOWrapper, type_name: str):
 def define_accept_instantiations(file: TextIOWrapper, base_class: str, type_name: str, types: dict[str, str]):
 	file.write('template<class T>\n')
 	file.write(f'auto {base_class}::accept({type_name}_visitor_interface<T> &visitor, ID<{type_name}_type> id) const -> T {{\n')
-	file.write(f'\tswitch (id.type) {{\n\t\tusing enum {type_name}_type;\n\n')
+	define_accept_switch(file, type_name, types, 'T')
+
+def define_static_accept_instantiations(file: TextIOWrapper, base_class: str, type_name: str, types: dict[str, str]):
+	output_type: str = f'{type_name}_visitor_output_t<Visitor>'
+	file.write(f'template<{type_name}_visitor Visitor>\n')
+	file.write(f'auto {base_class}::accept(Visitor &visitor, ID<{type_name}_type> id) const -> {output_type} {{\n')
+	define_accept_switch(file, type_name, types, output_type)
+
+def define_accept_switch(file: TextIOWrapper, type_name: str, types: dict[str, str], output_type: str):
+	file.write(f'\tswitch (id.type()) {{\n\t\tusing enum {type_name}_type;\n\n')
 
 	space: int = max(len(utils.split_conditions_and_class_name(key)[1]) for key in types)
 
@@ -96,25 +107,354 @@ def define_accept_instantiations(file: TextIOWrapper, base_class: str, type_name
 
 	file.write('\t}\n')
 
-	file.write('\tif constexpr (!std::is_void_v<T>) { return {}; }\n')
+	file.write(f'\tif constexpr (!std::is_void_v<{output_type}>) {{ return {output_type}{{}}; }}\n')
 	# file.write('\treturn {{}};\n')
 	file.write('}\n\n')
 
-def define_program_class(out_dir: str, class_name: str, config: configuration) -> None:
+def split_field(field: str) -> tuple[str, str]:
+	(type, name) = field.strip().rsplit(' ', 1)
+	return (type.strip(), name.strip())
+
+def pooled_type(field_type: str) -> tuple[str, str] | None:
+	for kind in POOL_KINDS:
+		prefix: str = f'lox::{kind}<'
+		if field_type.startswith(prefix) and field_type.endswith('>'):
+			return (kind, field_type.removeprefix(prefix).removesuffix('>'))
+	return None
+
+def pool_name(element_type: str) -> str:
+	return element_type.removeprefix('lox::') + 's'
+
+def collect_pools(config: configuration) -> dict[str, set[str]]:
+	pools: dict[str, set[str]] = {}
+	for types in (config.expressions, config.statements):
+		for fields in types.values():
+			for field in fields.split(','):
+				if (pooled := pooled_type(split_field(field)[0])) is not None:
+					(kind, element_type) = pooled
+					pools.setdefault(element_type, set()).add(kind)
+	return pools
+
+def define_pools_struct(file: TextIOWrapper, pools: dict[str, set[str]]) -> str:
+	name: str = 'pools_records'
+	file.write(f'/// The children lists and the values of the nodes, every node refers to a part of them\n')
+	file.write(f'struct {name} {{\n')
+	for element_type in pools:
+		file.write(f'\tstd::vector<{element_type}> {pool_name(element_type)}{{}};\n')
+	file.write(f'\n\t[[nodiscard]] auto operator==(const {name} &other) const -> bool = default;\n')
+	file.write('};\n\n')
+	return name
+
+def define_pool_accessors(file: TextIOWrapper, pools: dict[str, set[str]]) -> None:
+	for (element_type, kinds) in pools.items():
+		pool: str = f'pools_db.{pool_name(element_type)}'
+		if 'pool_range' in kinds:
+			file.write(f'\t[[nodiscard]] auto get(pool_range<{element_type}> range) const noexcept -> std::span<const {element_type}> {{\n')
+			file.write(f'\t\treturn std::span{{ {pool} }}.subspan(range.offset, range.count);\n')
+			file.write('\t}\n\n')
+			file.write(f'\t[[nodiscard]] auto get(pool_range<{element_type}> range) noexcept -> std::span<{element_type}> {{\n')
+			file.write(f'\t\treturn std::span{{ {pool} }}.subspan(range.offset, range.count);\n')
+			file.write('\t}\n\n')
+			file.write(f'\tauto store(std::span<const {element_type}> values) -> pool_range<{element_type}> {{\n')
+			file.write(f'\t\tconst pool_range<{element_type}> range{{\n')
+			file.write(f'\t\t\t.offset = static_cast<uint32_t>(std::size({pool})),\n')
+			file.write('\t\t\t.count  = static_cast<uint32_t>(std::size(values))\n')
+			file.write('\t\t};\n')
+			file.write(f'\t\t{pool}.insert(std::end({pool}), std::begin(values), std::end(values));\n')
+			file.write('\t\treturn range;\n')
+			file.write('\t}\n\n')
+		if 'pool_id' in kinds:
+			file.write(f'\t[[nodiscard]] auto get(pool_id<{element_type}> id) const noexcept -> const {element_type} & {{\n')
+			file.write(f'\t\treturn {pool}[id.index];\n')
+			file.write('\t}\n\n')
+			file.write(f'\tauto store({element_type} value) -> pool_id<{element_type}> {{\n')
+			file.write(f'\t\t{pool}.emplace_back(std::move(value));\n')
+			file.write(f'\t\treturn pool_id<{element_type}>{{ .index = static_cast<uint32_t>(std::size({pool}) - 1u) }};\n')
+			file.write('\t}\n\n')
+
+def define_append(file: TextIOWrapper, class_name: str, config: configuration, pools: dict[str, set[str]]) -> None:
+	file.write(f'inline void {class_name}::append({class_name} &&other) {{\n')
+
+	for element_type in pools:
+		name: str = pool_name(element_type)
+		file.write(f'\tconst auto {name}_offset{{ static_cast<uint32_t>(std::size(pools_db.{name})) }};\n')
+	file.write('\n')
+
+	for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+		file.write(f'\t/// The shifted ids have to fit as well, so nothing is appended when the records would grow too large\n')
+		for type in types:
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			utils.open_conditions(conditions, file)
+			records: str = f'{type_name}s_db.{cls_name}s'
+			file.write(f'\tstd::ignore = {type_name}_id::make_index(std::size({records}) + std::size(other.{records}));\n')
+			utils.close_conditions(conditions, file)
+
+		file.write(f'\tconst std::array {type_name}_offsets{{\n')
+		for type in types:
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			utils.open_conditions(conditions, file)
+			file.write(f'\t\tstatic_cast<{type_name}_id::index_type>(std::size({type_name}s_db.{cls_name}s)),\n')
+			utils.close_conditions(conditions, file)
+		file.write('\t};\n')
+		file.write(f'\tconst auto shift_{type_name}{{ [&{type_name}_offsets]({type_name}_id &id) noexcept {{\n')
+		file.write(f'\t\tif (!id.empty()) id.index += {type_name}_offsets[static_cast<size_t>(id.type())];\n')
+		file.write('\t} };\n\n')
+
+	id_types: tuple[str, str] = (f'{config.expression_class}_id', f'{config.statement_class}_id')
+	for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+		for (type, fields) in types.items():
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			records: str = f'{type_name}s_db.{cls_name}s'
+			utils.open_conditions(conditions, file)
+
+			shifts: list[str] = []
+			for field in fields.split(','):
+				(field_type, field_name) = split_field(field)
+				if (pooled := pooled_type(field_type)) is not None:
+					(kind, element_type) = pooled
+					member: str = 'offset' if kind == 'pool_range' else 'index'
+					shifts.append(f'\t\tnode.{field_name}.{member} += {pool_name(element_type)}_offset;\n')
+				for id_type in id_types:
+					shift: str = f'shift_{id_type.removesuffix("_id")}'
+					if field_type == id_type:
+						shifts.append(f'\t\t{shift}(node.{field_name});\n')
+					elif field_type == f'std::vector<{id_type}>':
+						shifts.append(f'\t\tfor (auto &id : node.{field_name}) {shift}(id);\n')
+
+			if shifts:
+				file.write(f'\tfor (auto &node : other.{records}) {{\n')
+				file.write(''.join(shifts))
+				file.write('\t}\n')
+			file.write(f'\t{records}.insert(std::end({records}),\n')
+			file.write(f'\t\tstd::make_move_iterator(std::begin(other.{records})), std::make_move_iterator(std::end(other.{records}))\n')
+			file.write('\t);\n')
+			utils.close_conditions(conditions, file)
+
+	file.write('\n')
+	for element_type in pools:
+		pool: str = f'pools_db.{pool_name(element_type)}'
+		if element_type in id_types:
+			file.write(f'\tfor (auto &id : other.{pool}) shift_{element_type.removesuffix("_id")}(id);\n')
+		file.write(f'\t{pool}.insert(std::end({pool}),\n')
+		file.write(f'\t\tstd::make_move_iterator(std::begin(other.{pool})), std::make_move_iterator(std::end(other.{pool}))\n')
+		file.write('\t);\n')
+
+	stmts_name: str = f'{config.statement_class}s'
+	file.write(f'\n\tfor (auto id : other.{stmts_name}) {{\n')
+	file.write(f'\t\tshift_{config.statement_class}(id);\n')
+	file.write(f'\t\t{stmts_name}.emplace_back(id);\n')
+	file.write('\t}\n')
+	file.write(f'\tother = {class_name}{{}};\n')
+	file.write('}\n\n')
+
+def layout_hash(config: configuration) -> int:
+	hash: int = 0xCBF29CE484222325
+	for types in (config.expressions, config.statements):
+		for (type, fields) in types.items():
+			for byte in f'{type}:{fields};'.encode():
+				hash = ((hash ^ byte) * 0x00000100000001B3) & 0xFFFFFFFFFFFFFFFF
+	return hash
+
+def serialized_members(config: configuration, pools: dict[str, set[str]]) -> list[tuple[list[str], str]]:
+	members: list[tuple[list[str], str]] = []
+	for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+		for type in types:
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			members.append((conditions, f'{type_name}s_db.{cls_name}s'))
+	for element_type in pools:
+		members.append(([], f'pools_db.{pool_name(element_type)}'))
+	members.append(([], f'{config.statement_class}s'))
+	return members
+
+def define_serialization(file: TextIOWrapper, class_name: str, config: configuration, pools: dict[str, set[str]]) -> None:
+	members: list[tuple[list[str], str]] = serialized_members(config, pools)
+
+	file.write('template<class Writer>\n')
+	file.write(f'void {class_name}::serialize(Writer &out) const {{\n')
+	for (conditions, member) in members:
+		utils.open_conditions(conditions, file)
+		file.write(f'\tout.write({member});\n')
+		utils.close_conditions(conditions, file)
+	file.write('}\n\n')
+
+	file.write('template<class Reader>\n')
+	file.write(f'auto {class_name}::deserialize(Reader &in) -> bool {{\n')
+	for (conditions, member) in members:
+		utils.open_conditions(conditions, file)
+		file.write(f'\tif (!in.read({member})) return false;\n')
+		utils.close_conditions(conditions, file)
+	file.write('\treturn true;\n')
+	file.write('}\n\n')
+
+def define_contains(file: TextIOWrapper, type_name: str, types: dict[str, str]) -> None:
+	file.write(f'\t[[nodiscard]] auto contains({type_name}_id id) const noexcept -> bool {{\n')
+	file.write('\t\tif (id.empty()) return true;\n\n')
+	file.write(f'\t\tswitch (id.type()) {{\n\t\t\tusing enum {type_name}_type;\n\n')
+
+	space: int = max(len(utils.split_conditions_and_class_name(key)[1]) for key in types)
+	for type in types:
+		(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+		utils.open_conditions(conditions, file)
+		file.write(f'\t\t\tcase {cls_name:<{space}}: return id.index < std::size({type_name}s_db.{cls_name}s);\n')
+		utils.close_conditions(conditions, file)
+
+	file.write('\n\t\t\tdefault: break;\n')
+	file.write('\t\t}\n')
+	file.write('\t\treturn false;\n')
+	file.write('\t}\n\n')
+
+def define_validation(file: TextIOWrapper, class_name: str, config: configuration, pools: dict[str, set[str]]) -> None:
+	id_types: tuple[str, str] = (f'{config.expression_class}_id', f'{config.statement_class}_id')
+
+	file.write('template<class Validator>\n')
+	file.write(f'auto {class_name}::validate(const Validator &valid) const -> bool {{\n')
+	file.write('\tconst auto within{ [](const auto &pool, const auto range) noexcept {\n')
+	file.write('\t\treturn static_cast<uint64_t>(range.offset) + range.count <= std::size(pool);\n')
+	file.write('\t} };\n\n')
+
+	for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+		for (type, fields) in types.items():
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			checks: list[str] = []
+			for field in fields.split(','):
+				(field_type, field_name) = split_field(field)
+				if field_type in id_types:
+					checks.append(f'contains(node.{field_name})')
+				elif (pooled := pooled_type(field_type)) is not None:
+					(kind, element_type) = pooled
+					pool: str = f'pools_db.{pool_name(element_type)}'
+					if kind == 'pool_range':
+						checks.append(f'within({pool}, node.{field_name})')
+					else:
+						checks.append(f'node.{field_name}.index < std::size({pool})')
+				else:
+					checks.append(f'valid(node.{field_name})')
+
+			utils.open_conditions(conditions, file)
+			file.write(f'\tfor (const auto &node : {type_name}s_db.{cls_name}s) {{\n')
+			condition: str = f'({" && ".join(checks)})'
+			if len(checks) == 1 and ' ' not in checks[0]:
+				condition = checks[0]
+			file.write(f'\t\tif (!{condition}) return false;\n')
+			file.write('\t}\n')
+			utils.close_conditions(conditions, file)
+
+	for element_type in pools:
+		check: str = 'contains(element)' if element_type in id_types else 'valid(element)'
+		file.write(f'\tfor (const auto &element : pools_db.{pool_name(element_type)}) {{\n')
+		file.write(f'\t\tif (!{check}) return false;\n')
+		file.write('\t}\n')
+
+	stmts_name: str = f'{config.statement_class}s'
+	file.write(f'\tfor (const auto id : {stmts_name}) {{\n')
+	file.write('\t\tif (!contains(id)) return false;\n')
+	file.write('\t}\n')
+	file.write('\treturn true;\n')
+	file.write('}\n\n')
+
+def define_relayout_node(file: TextIOWrapper, class_name: str, config: configuration, type_name: str, types: dict[str, str]) -> None:
+	id_type: str = f'{type_name}_id'
+	id_types: tuple[str, str] = (f'{config.expression_class}_id', f'{config.statement_class}_id')
+
+	file.write(f'inline auto {class_name}::relayout({class_name} &out, relayout_maps &maps, {id_type} id) const -> {id_type} {{\n')
+	file.write('\tif (id.empty()) return id;\n\n')
+	file.write(f'\tauto &moved{{ maps.{type_name}s[static_cast<size_t>(id.type())][id.index] }};\n')
+	file.write(f'\tif (moved != {id_type}::invalid_index) return {id_type}{{ moved, id.type() }};\n\n')
+	file.write(f'\tswitch (id.type()) {{\n\t\tusing enum {type_name}_type;\n\n')
+
+	for (type, fields) in types.items():
+		(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+		records: str = f'{type_name}s_db.{cls_name}s'
+		utils.open_conditions(conditions, file)
+		file.write(f'\t\tcase {cls_name}: {{\n')
+		file.write(f'\t\t\tconst auto &node{{ {records}[id.index] }};\n')
+		file.write(f'\t\t\tmoved = {id_type}::make_index(std::size(out.{records}));\n')
+		file.write(f'\t\t\tout.{records}.emplace_back(node);\n')
+
+		for field in fields.split(','):
+			(field_type, field_name) = split_field(field)
+			target: str = f'out.{records}[moved].{field_name}'
+			if field_type in id_types:
+				file.write(f'\t\t\t{target} = relayout(out, maps, node.{field_name});\n')
+			elif (pooled := pooled_type(field_type)) is not None:
+				(kind, element_type) = pooled
+				if kind == 'pool_range' and element_type in id_types:
+					file.write('\t\t\t{\n')
+					file.write('\t\t\t\t/// The children are stored first, so they stay together whatever their own children are\n')
+					file.write(f'\t\t\t\tconst auto children{{ get(node.{field_name}) }};\n')
+					file.write(f'\t\t\t\tconst auto range{{ out.store(children) }};\n')
+					file.write(f'\t\t\t\t{target} = range;\n')
+					file.write('\t\t\t\tfor (uint32_t i{}; i < range.count; ++i) {\n')
+					file.write(f'\t\t\t\t\tout.pools_db.{pool_name(element_type)}[range.offset + i] = relayout(out, maps, children[i]);\n')
+					file.write('\t\t\t\t}\n')
+					file.write('\t\t\t}\n')
+				else:
+					file.write(f'\t\t\t{target} = out.store(get(node.{field_name}));\n')
+
+		file.write('\t\t\tbreak;\n')
+		file.write('\t\t}\n')
+		utils.close_conditions(conditions, file)
+
+	file.write('\n\t\tdefault: break;\n')
+	file.write('\t}\n')
+	file.write(f'\treturn {id_type}{{ moved, id.type() }};\n')
+	file.write('}\n\n')
+
+def define_relayout(file: TextIOWrapper, class_name: str, config: configuration, pools: dict[str, set[str]]) -> None:
+	file.write(f'inline void {class_name}::relayout() {{\n')
+	file.write('\trelayout_maps maps{};\n')
+	file.write(f'\t{class_name} out{{}};\n')
+	for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+		for type in types:
+			(conditions, cls_name) = utils.split_conditions_and_class_name(type)
+			records: str = f'{type_name}s_db.{cls_name}s'
+			utils.open_conditions(conditions, file)
+			file.write(f'\tmaps.{type_name}s[static_cast<size_t>({type_name}_type::{cls_name})].assign(std::size({records}), {type_name}_id::invalid_index);\n')
+			file.write(f'\tout.{records}.reserve(std::size({records}));\n')
+			utils.close_conditions(conditions, file)
+	for element_type in pools:
+		pool: str = f'pools_db.{pool_name(element_type)}'
+		file.write(f'\tout.{pool}.reserve(std::size({pool}));\n')
+
+	stmts_name: str = f'{config.statement_class}s'
+	file.write(f'\n\tout.{stmts_name}.reserve(std::size({stmts_name}));\n')
+	file.write(f'\tfor (const auto id : {stmts_name}) {{\n')
+	file.write(f'\t\tout.{stmts_name}.emplace_back(relayout(out, maps, id));\n')
+	file.write('\t}\n')
+	file.write('\t*this = std::move(out);\n')
+	file.write('}\n\n')
+
+	define_relayout_node(file, class_name, config, config.expression_class, config.expressions)
+	define_relayout_node(file, class_name, config, config.statement_class, config.statements)
+
+def define_static_accept_declarations(file: TextIOWrapper, config: configuration) -> None:
+	file.write('\n\t/// The visitor methods are called directly, so a final visitor gets them inlined\n')
+	for type_name in (config.expression_class, config.statement_class):
+		file.write(f'\ttemplate<{type_name}_visitor Visitor>\n')
+		file.write(f'\t[[nodiscard]] auto accept(Visitor &visitor, ID<{type_name}_type> id) const -> {type_name}_visitor_output_t<Visitor>;\n')
+
+def define_program_class(out_dir: str, class_name: str, config: configuration, static_visitors: bool) -> None:
 	header_file_path: str = os.path.join(out_dir, constants.INCLUDE_DIR, class_name + '.hpp').replace('\\', '/')
 	statements_include: str = utils.make_include_path(config.statement_class)
 
 	with open(header_file_path, 'w+') as header:
 		header.write(constants.DISCLAIMER.format(generator_filename = utils.get_filename(__file__)))
 		header.write(constants.HEADER_BEGIN)
-		header.write('\n#include <vector>\n')
+		header.write('\n#include <span>\n')
+		header.write('#include <array>\n')
+		header.write('#include <cstdint>\n')
+		header.write('#include <vector>\n')
+		header.write('#include <iterator>\n')
 		header.write('#include <stdexcept>\n')
+		header.write('#include <tuple>\n')
 		header.write('#include <type_traits>\n')
 		header.write(f'#include {statements_include}\n')
 		header.write(constants.OPEN_NAMESPACE)
 
 		exprs_records: str = define_records_struct(header, config.expression_class, config.expressions)
 		stmts_records: str = define_records_struct(header, config.statement_class, config.statements)
+		pools: dict[str, set[str]] = collect_pools(config)
+		pools_records: str = define_pools_struct(header, pools)
 
 		header.write(f'class {class_name} {{\npublic:\n')
 		header.write(f'\tusing {config.statement_class}_list = std::vector<{config.statement_class}_id>;\n\n')
@@ -122,10 +462,12 @@ def define_program_class(out_dir: str, class_name: str, config: configuration) -
 		header.write(f'\t{class_name}(\n')
 		header.write(f'\t\t{exprs_records} {config.expression_class}s_db,\n')
 		header.write(f'\t\t{stmts_records} {config.statement_class}s_db,\n')
+		header.write(f'\t\t{pools_records} pools_db,\n')
 		header.write(f'\t\t{config.statement_class}_list {config.statement_class}s\n')
 		header.write('\t) noexcept\n')
 		header.write(f'\t\t: {config.expression_class}s_db{{ std::move({config.expression_class}s_db) }}\n')
 		header.write(f'\t\t, {config.statement_class}s_db{{ std::move({config.statement_class}s_db) }}\n')
+		header.write('\t\t, pools_db{ std::move(pools_db) }\n')
 		header.write(f'\t\t, {config.statement_class}s{{ std::move({config.statement_class}s) }}\n')
 		header.write('\t{}\n')
 
@@ -146,26 +488,81 @@ def define_program_class(out_dir: str, class_name: str, config: configuration) -
 		define_get_with_id(header, config.expression_class)
 		define_get_with_id(header, config.statement_class)
 
+		header.write('\t/// The id is empty or refers to an existing node\n')
+		define_contains(header, config.expression_class, config.expressions)
+		define_contains(header, config.statement_class, config.statements)
+
+		define_pool_accessors(header, pools)
+
 		header.write('\ttemplate<class T>\n')
 		header.write(f'\t[[nodiscard]] auto accept({config.expression_class}_visitor_interface<T> &visitor, ID<{config.expression_class}_type> id) const -> T;\n\n')
 		header.write('\ttemplate<class T>\n')
 		header.write(f'\t[[nodiscard]] auto accept({config.statement_class}_visitor_interface<T> &visitor, ID<{config.statement_class}_type> id) const -> T;\n')
+		if static_visitors:
+			define_static_accept_declarations(header, config)
 
 		header.write(DEFAULT_GETTERS_METHODS.format(stmts_name = f'{config.statement_class}s'))
 
+		header.write('\n\t/// The programs are equal when their nodes lie in the same order, relayout() both to compare the trees\n')
+		header.write(f'\t[[nodiscard]] auto operator==(const {class_name} &other) const -> bool = default;\n')
+
+		header.write('\n\t/// Moves the nodes of the other program after these ones and shifts the ids inside of them\n')
+		header.write(f'\tvoid append({class_name} &&other);\n')
+
+		header.write('\n\t/// The hash of the node types and their fields, the programs serialized with another layout are refused\n')
+		header.write(f'\tstatic constexpr uint64_t layout_hash{{ 0x{layout_hash(config):016X}u }};\n\n')
+		header.write('\t/// Gives every record, pool and the statements to out.write() in the order deserialize() reads them\n')
+		header.write('\ttemplate<class Writer>\n')
+		header.write('\tvoid serialize(Writer &out) const;\n')
+		header.write('\t/** @return false as soon as in.read() fails, the program is left partially read then */\n')
+		header.write('\ttemplate<class Reader>\n')
+		header.write('\t[[nodiscard]] auto deserialize(Reader &in) -> bool;\n')
+		header.write('\t/**\n')
+		header.write('\t * @brief Checks that every node id and pool reference lies within its records.\n')
+		header.write('\t * The other fields and the values of the other pools are given to valid()\n')
+		header.write('\t */\n')
+		header.write('\ttemplate<class Validator>\n')
+		header.write('\t[[nodiscard]] auto validate(const Validator &valid) const -> bool;\n')
+
+		header.write('\n\t/**\n')
+		header.write('\t * @brief Renumbers the nodes and the pools in the order the tree walk meets them.\n')
+		header.write('\t * A node comes before its children and the body of a function right after it, so\n')
+		header.write('\t * every record is read mostly forward. The nodes no statement leads to are dropped.\n')
+		header.write('\t */\n')
+		header.write('\tvoid relayout();\n')
+
 		header.write('protected:\n')
 		header.write(f'\t{exprs_records} {config.expression_class}s_db{{}};\n')
 		header.write(f'\t{stmts_records} {config.statement_class}s_db{{}};\n')
+		header.write(f'\t{pools_records} pools_db{{}};\n')
 		header.write(f'\t{config.statement_class}_list {config.statement_class}s{{}};\n')
 
+		header.write('private:\n')
+		header.write('\t/// The new indices by the old ones for every node type, invalid_index till the node is moved\n')
+		header.write('\tstruct relayout_maps {\n')
+		for (type_name, types) in ((config.expression_class, config.expressions), (config.statement_class, config.statements)):
+			header.write(f'\t\tstd::array<std::vector<{type_name}_id::index_type>, {len(types)}> {type_name}s{{}};\n')
+		header.write('\t};\n\n')
+		for type_name in (config.expression_class, config.statement_class):
+			header.write(f'\tauto relayout({class_name} &out, relayout_maps &maps, {type_name}_id id) const -> {type_name}_id;\n')
+
 		header.write('};\n\n')
 
 		define_get_instantiations(header, class_name, config.statement_class, config.statements)
 		define_get_instantiations(header, class_name, config.expression_class, config.expressions)
 
+		define_append(header, class_name, config, pools)
+		define_serialization(header, class_name, config, pools)
+		define_validation(header, class_name, config, pools)
+		define_relayout(header, class_name, config, pools)
+
 		define_accept_instantiations(header, class_name, config.statement_class, config.statements)
 		define_accept_instantiations(header, class_name, config.expression_class, config.expressions)
 
+		if static_visitors:
+			define_static_accept_instantiations(header, class_name, config.statement_class, config.statements)
+			define_static_accept_instantiations(header, class_name, config.expression_class, config.expressions)
+
 		header.write(constants.CLOSE_NAMESPACE)
 
 	# include_path: str = '"' + os.path.join(INCLUDE_DIR.removeprefix('include/'), class_name + '.hpp"').replace('\\', '/')
@@ -177,7 +574,7 @@ def main(args: Namespace) -> int:
 
 	config = configuration(args.config)
 
-	define_program_class(output_path, CLASS_NAME, config)
+	define_program_class(output_path, CLASS_NAME, config, args.static_visitors)
 
 	return 0
 
@@ -188,5 +585,8 @@ if __name__ == '__main__':
 	)
 	parser.add_argument('--output', type=str, help='The path to output directory')
 	parser.add_argument('--config', type=str, help='The path to the generation info JSON file')
+	parser.add_argument('--static-visitors', action='store_true',
+		help='Generate the accept overloads calling the visitor concepts without the virtual dispatch'
+	)
 	exit(main(parser.parse_args()))
 